@@ -1,802 +1,5517 @@
-#include <iostream>
-#include <vector>
-#include <string>
-#include <conio.h>
-#include <windows.h>
-#include <time.h>
-#include <cmath>
-#include <chrono>
-#include <iomanip>
-#include <fstream>
-
-using namespace std;
-using namespace std::chrono;
-
-// ==========================================
-// 1. GLOBAL SETTINGS & VARIABLES
-// ==========================================
-
-const int WIDTH = 90;
-const int HEIGHT = 26;
-const int TARGET_FPS = 120; // Doubled from 60 to 120 for 2x speed
-const int FRAME_TIME = 1000 / TARGET_FPS; // milliseconds per frame
-const string HIGH_SCORE_FILE = "highscore.dat";
-
-// Color Codes
-const int BLUE = 9;
-const int GREEN = 10;
-const int CYAN = 11;
-const int RED = 12;
-const int MAGENTA = 13;
-const int YELLOW = 14;
-const int WHITE = 15;
-const int DARKBROWN = 6;
-
-struct Object {
-    int x, y;
-    int hp;
-    int type; // 0 = Small Enemy, 1 = Monster
-};
-
-struct Bullet {
-    float x, y; 
-    bool isPlayer;
-    int dy; 
-};
-
-struct PowerUp {
-    int x, y;
-    bool active;
-};
-
-char board[HEIGHT][WIDTH];
-int playerX, playerY;
-int playerHP;
-int score;
-int highScore = 0;
-int enemiesKilledForBoost;
-int triShotAmmo;
-bool hasBomb; 
-int bossHP;
-int maxBossHP;
-bool bossActive;
-bool gameRunning;
-bool isPaused; 
-
-vector<Object> enemies;
-vector<Bullet> bullets;
-PowerUp boostPack;
-
-// Frame timing
-high_resolution_clock::time_point lastFrameTime;
-int frameCounter = 0;
-
-// Difficulty scaling
-float difficultyMultiplier = 1.0f;
-int lastScoreMilestone = 0;
-
-// ==========================================
-// 2. HELPER FUNCTIONS
-// ==========================================
-
-void Color(int color) {
-    SetConsoleTextAttribute(GetStdHandle(STD_OUTPUT_HANDLE), color);
-}
-
-void Gotoxy(int x, int y) {
-    COORD coord = { (SHORT)x, (SHORT)y };
-    SetConsoleCursorPosition(GetStdHandle(STD_OUTPUT_HANDLE), coord);
-}
-
-void HideCursor() {
-    CONSOLE_CURSOR_INFO cursorInfo;
-    GetConsoleCursorInfo(GetStdHandle(STD_OUTPUT_HANDLE), &cursorInfo);
-    cursorInfo.bVisible = false;
-    SetConsoleCursorInfo(GetStdHandle(STD_OUTPUT_HANDLE), &cursorInfo);
-}
-
-// ==========================================
-// 3. HIGH SCORE MANAGEMENT
-// ==========================================
-
-int LoadHighScore() {
-    ifstream file(HIGH_SCORE_FILE);
-    int score = 0;
-    if (file.is_open()) {
-        file >> score;
-        file.close();
-    }
-    return score;
-}
-
-void SaveHighScore(int score) {
-    ofstream file(HIGH_SCORE_FILE);
-    if (file.is_open()) {
-        file << score;
-        file.close();
-    }
-}
-
-void UpdateHighScore() {
-    if (score > highScore) {
-        highScore = score;
-        SaveHighScore(highScore);
-    }
-}
-
-// ==========================================
-// 4. SOUNDS & MUSIC
-// ==========================================
-
-void PlayFireSound() { Beep(800, 5); }
-void PlayHitSound() { Beep(200, 10); }
-void PlayExplosionSound() { Beep(100, 30); }
-void PlayPowerUpSound() { Beep(1200, 20); Beep(1500, 20); }
-void PlayMenuSound() { Beep(400, 50); }
-void PlayHighScoreSound() { 
-    Beep(800, 100); 
-    Beep(1000, 100); 
-    Beep(1200, 100); 
-    Beep(1500, 200); 
-}
-
-// ==========================================
-// 5. GRAPHICS & MENU
-// ==========================================
-
-// Forward declarations
-void ShowMissionBriefing();
-void ShowHowToPlay();
-void ShowHighScores();
-
-void DrawLogo(bool blinkState) {
-    Gotoxy(0, 1);
-    if (blinkState) Color(CYAN); else Color(BLUE);
-    cout << "\t    _   _ ___ _____ _   _ _____  _    _  ___  ______ " << endl;
-    cout << "\t   | \\ | |_ _/  ___| | | |_   _|| |  | |/ _ \\ | ___ \\" << endl;
-    if (blinkState) Color(WHITE); else Color(RED);
-    cout << "\t   |  \\| || |\\ `--. | |_| | | |  | |  | / /_\\ \\| |_/ /" << endl;
-    cout << "\t   | . ` || | `--. \\|  _  | | |  | |/\\| |  _  ||    / " << endl;
-    if (blinkState) Color(CYAN); else Color(BLUE);
-    cout << "\t   | |\\  || |/\\__/ /| | | | | |  \\  /\\  / | | || |\\ \\ " << endl;
-    cout << "\t   \\_| \\_/\\_/\\____/ \\_| |_/ \\_/   \\/  \\/\\_| |_/\\_| \\_|" << endl;
-    Color(WHITE);
-    Gotoxy(25, 10); cout << "--- THE ULTIMATE WARRIOR ARCADE ---";
-}
-
-void ShowMenu() {
-    system("cls");
-    bool blink = true;
-    int blinkCounter = 0;
-    
-    while (!_kbhit()) {
-        Gotoxy(0, 0);
-        Color(CYAN);
-        for (int i = 0; i < 92; i++) cout << (char)205; cout << endl;
-        
-        DrawLogo(blink);
-        
-        // Display high score
-        Gotoxy(32, 11); 
-        Color(YELLOW); 
-        cout << "HIGH SCORE: " << highScore;
-        
-        if (++blinkCounter % 3 == 0) blink = !blink;
-        PlayMenuSound();
-        
-        Gotoxy(0, 12);
-        Color(CYAN);
-        for (int i = 0; i < 92; i++) cout << (char)205; cout << endl;
-        
-        Gotoxy(0, 13);
-        Color(CYAN);
-        cout << (char)186; 
-        for (int i = 0; i < 90; i++) cout << " ";
-        cout << (char)186 << endl;
-        
-        Gotoxy(28, 14); Color(YELLOW); cout << (char)187 << " 1. START MISSION " << (char)187;
-        Gotoxy(0, 15); Color(CYAN); cout << (char)186;
-        for (int i = 0; i < 90; i++) cout << " ";
-        cout << (char)186 << endl;
-        
-        Gotoxy(28, 16); Color(WHITE);  cout << (char)187 << " 2. MISSION BRIEFING " << (char)187;
-        Gotoxy(0, 17); Color(CYAN); cout << (char)186;
-        for (int i = 0; i < 90; i++) cout << " ";
-        cout << (char)186 << endl;
-        
-        Gotoxy(28, 18); Color(CYAN);   cout << (char)187 << " 3. HOW TO PLAY " << (char)187;
-        Gotoxy(0, 19); Color(CYAN); cout << (char)186;
-        for (int i = 0; i < 90; i++) cout << " ";
-        cout << (char)186 << endl;
-        
-        Gotoxy(28, 20); Color(RED);    cout << (char)187 << " 4. RETREAT (Exit) " << (char)187;
-        Gotoxy(0, 21); Color(CYAN); cout << (char)186;
-        for (int i = 0; i < 90; i++) cout << " ";
-        cout << (char)186 << endl;
-        
-        Gotoxy(0, 22);
-        Color(CYAN);
-        for (int i = 0; i < 92; i++) cout << (char)205; cout << endl;
-        
-        Sleep(200); 
-    }
-    char ch = _getch();
-    if (ch == '1') return;
-    if (ch == '2') {
-        ShowMissionBriefing();
-    }
-    if (ch == '3') {
-        ShowHowToPlay();
-    }
-    if (ch == '4') exit(0);
-}
-
-void ShowMissionBriefing() {
-    system("cls");
-    Color(MAGENTA);
-    cout << "\n";
-    for (int i = 0; i < 80; i++) cout << "=";
-    cout << "\n";
-    Color(CYAN);
-    cout << "\t\t\t   *** MISSION BRIEFING ***\n";
-    Color(MAGENTA);
-    cout << "\n";
-    for (int i = 0; i < 80; i++) cout << "=";
-    cout << "\n\n";
-    
-    Color(YELLOW);
-    cout << "\t STATUS: CLASSIFIED TOP SECRET\n\n";
-    
-    Color(WHITE);
-    cout << "\t OBJECTIVE:\n";
-    Color(GREEN);
-    cout << "\t   Defend Earth against an alien invasion. Small enemy jets are attacking\n";
-    cout << "\t   in waves, and a massive boss monster awaits at higher threat levels.\n";
-    cout << "\t   When the boss appears, it brings fighter escorts to overwhelm defenses!\n\n";
-    
-    Color(WHITE);
-    cout << "\t ENEMY INTEL:\n";
-    Color(RED);
-    cout << "\t   - Red Jets: Fast-moving scouts (5 points each)\n";
-    cout << "\t   - Purple Monster: Heavy Boss Unit (100 points)\n";
-    cout << "\t   - Boss Escort: 4-6 fighter jets accompany each boss wave\n";
-    cout << "\t   - During boss battles, additional fighters continue spawning\n\n";
-    
-    Color(WHITE);
-    cout << "\t REWARD SYSTEM:\n";
-    Color(YELLOW);
-    cout << "\t   - Eliminate 10 jets to earn a Health Boost Power-Up\n";
-    cout << "\t   - Each boss defeated grants 100 points\n\n";
-    
-    Color(WHITE);
-    cout << "\t SPECIAL WEAPONS:\n";
-    Color(MAGENTA);
-    cout << "\t   - Tri-Shot Ammo: 60 rounds available when boss appears\n";
-    cout << "\t   - Bomb Charge: Activate when boss is active (20 damage)\n\n";
-    
-    Color(MAGENTA);
-    for (int i = 0; i < 80; i++) cout << "=";
-    cout << "\n";
-    Color(WHITE);
-    cout << "\n\t\t\t   Press any key to return to menu...";
-    Color(WHITE);
-    _getch();
-    ShowMenu();
-}
-
-void ShowHowToPlay() {
-    system("cls");
-    Color(MAGENTA);
-    cout << "\n";
-    for (int i = 0; i < 80; i++) cout << "=";
-    cout << "\n";
-    Color(CYAN);
-    cout << "\t\t\t      *** HOW TO PLAY ***\n";
-    Color(MAGENTA);
-    cout << "\n";
-    for (int i = 0; i < 80; i++) cout << "=";
-    cout << "\n\n";
-    
-    Color(YELLOW);
-    cout << "\t MOVEMENT:\n";
-    Color(WHITE);
-    cout << "\t   UP ARROW    -> Move upward\n";
-    cout << "\t   DOWN ARROW  -> Move downward\n";
-    cout << "\t   LEFT ARROW  -> Move left\n";
-    cout << "\t   RIGHT ARROW -> Move right\n\n";
-    
-    Color(YELLOW);
-    cout << "\t COMBAT:\n";
-    Color(WHITE);
-    cout << "\t   SPACEBAR -> Fire continuous beam at enemies\n";
-    cout << "\t   B KEY    -> Activate bomb (when available & boss is active)\n";
-    cout << "\t              - Bomb deals 20 damage to the boss\n\n";
-    
-    Color(YELLOW);
-    cout << "\t GAME CONTROL:\n";
-    Color(WHITE);
-    cout << "\t   P KEY   -> Pause/Resume game\n";
-    cout << "\t   ESC KEY -> Quit game\n\n";
-    
-    Color(YELLOW);
-    cout << "\t GAME MECHANICS:\n";
-    Color(GREEN);
-    cout << "\t   + Collect health boost power-ups to recover health (max: 100%)\n";
-    cout << "\t   + Avoid enemy bullets or take damage\n";
-    cout << "\t   + Your ship has a default health of 100%\n";
-    cout << "\t   + Game ends when your health reaches 0%\n";
-    cout << "\t   + Boss appears every 30 points with 4-6 fighter escorts\n";
-    cout << "\t   + During boss battles, more fighters spawn continuously\n";
-    cout << "\t   + Game speed increases every 20 points (up to 2.5x max)\n";
-    cout << "\t   + High score is automatically saved to file\n\n";
-    
-    Color(YELLOW);
-    cout << "\t TRI-SHOT WEAPON:\n";
-    Color(MAGENTA);
-    cout << "\t   When active, spacebar fires 3 bullets instead of 1\n";
-    cout << "\t   Available: 60 ammo rounds per boss encounter\n\n";
-    
-    Color(MAGENTA);
-    for (int i = 0; i < 80; i++) cout << "=";
-    cout << "\n";
-    Color(WHITE);
-    cout << "\n\t\t\t   Press any key to return to menu...";
-    Color(WHITE);
-    _getch();
-    ShowMenu();
-}
-
-void Setup() {
-    playerX = 5; playerY = HEIGHT / 2;
-    playerHP = 100; score = 0;
-    enemiesKilledForBoost = 0; triShotAmmo = 0;
-    hasBomb = false; bossActive = false;
-    boostPack.active = false; isPaused = false;
-    enemies.clear(); bullets.clear();
-    gameRunning = true;
-    frameCounter = 0;
-    lastFrameTime = high_resolution_clock::now();
-    difficultyMultiplier = 1.0f;
-    lastScoreMilestone = 0;
-}
-
-// ==========================================
-// 6. INPUT HANDLING
-// ==========================================
-
-void Input() {
-    // Check for pause key FIRST, only when P is pressed
-    static bool pKeyPressed = false;
-    if (GetAsyncKeyState('P') & 0x8000) {
-        if (!pKeyPressed) {
-            isPaused = !isPaused;
-            pKeyPressed = true;
-        }
-    } else {
-        pKeyPressed = false;
-    }
-    
-    if (isPaused) return;
-
-    // Check for bomb key
-    static bool bKeyPressed = false;
-    if (GetAsyncKeyState('B') & 0x8000) {
-        if (!bKeyPressed && bossActive && hasBomb) {
-            bossHP -= 20; 
-            hasBomb = false;
-            PlayExplosionSound();
-            bKeyPressed = true;
-        }
-    } else {
-        bKeyPressed = false;
-    }
-
-    // Smooth movement - responsive controls (2x speed)
-    int moveSpeed = 2; // Doubled from 1
-    if (GetAsyncKeyState(VK_UP) & 0x8000) playerY = max(2, playerY - moveSpeed);
-    if (GetAsyncKeyState(VK_DOWN) & 0x8000) playerY = min(HEIGHT - 3, playerY + moveSpeed);
-    if (GetAsyncKeyState(VK_LEFT) & 0x8000) playerX = max(1, playerX - moveSpeed);
-    if (GetAsyncKeyState(VK_RIGHT) & 0x8000) playerX = min(WIDTH / 2, playerX + moveSpeed);
-
-    // Firing with cooldown for better performance
-    static int fireCooldown = 0;
-    if (fireCooldown > 0) fireCooldown--;
-    
-    if (GetAsyncKeyState(VK_SPACE) & 0x8000) {
-        if (fireCooldown == 0) {
-            bullets.push_back({ (float)playerX + 7, (float)playerY, true, 0 });
-            if (triShotAmmo > 0) {
-                bullets.push_back({ (float)playerX + 7, (float)playerY, true, -1 });
-                bullets.push_back({ (float)playerX + 7, (float)playerY, true, 1 });
-                triShotAmmo--;
-            }
-            PlayFireSound();
-            fireCooldown = 3; // Reduced from 5 for faster firing
-        }
-    }
-    
-    if (GetAsyncKeyState(VK_ESCAPE)) gameRunning = false;
-}
-
-// ==========================================
-// 7. GAME LOGIC
-// ==========================================
-
-void Logic() {
-    if (isPaused) return;
-
-    frameCounter++;
-
-    // Progressive difficulty scaling - increases every 20 points
-    int currentMilestone = (score / 20) * 20;
-    if (currentMilestone > lastScoreMilestone) {
-        lastScoreMilestone = currentMilestone;
-        difficultyMultiplier += 0.12f; // Smoother increase: 12% every 20 points
-        if (difficultyMultiplier > 2.5f) difficultyMultiplier = 2.5f; // Cap at 2.5x speed
-    }
-
-    // Boss spawn logic
-    if (score > 0 && score % 30 == 0 && !bossActive) {
-        bossActive = true; maxBossHP = 100; bossHP = maxBossHP;
-        enemies.push_back({ WIDTH - 20, HEIGHT / 2, bossHP, 1 });
-        triShotAmmo = 60; hasBomb = true; 
-        
-        // Spawn fighter jets along with the boss
-        int numFighters = 4 + (rand() % 3); // 4 to 6 fighters
-        for (int f = 0; f < numFighters; f++) {
-            int spawnY = 3 + (rand() % (HEIGHT - 6));
-            int spawnX = WIDTH - 10 - (rand() % 15);
-            enemies.push_back({ spawnX, spawnY, 1, 0 });
-        }
-    }
-
-    // Enemy spawning - smoother controlled rate (2x speed)
-    if (enemies.size() < (bossActive ? 12 : 8)) {
-        int spawnRate = max(10, (int)(18 - (difficultyMultiplier - 1.0f) * 4)); // Halved for 2x speed
-        if (frameCounter % spawnRate == 0) {
-            enemies.push_back({ WIDTH - 6, (rand() % (HEIGHT - 6)) + 3, 1, 0 });
-        }
-    }
-
-    // Bullet Movement - optimized speeds (2x speed)
-    for (int i = 0; i < (int)bullets.size(); i++) {
-        if (bullets[i].isPlayer) {
-            bullets[i].x += 6.0f; // Doubled from 3.0
-            bullets[i].y += (float)bullets[i].dy * 0.5f; // Doubled from 0.25
-        } else { 
-            bullets[i].x -= 2.4f * difficultyMultiplier; // Doubled from 1.2
-            bullets[i].y += (float)bullets[i].dy * 0.8f; // Doubled from 0.4
-        }
-
-        if (bullets[i].x >= WIDTH || bullets[i].x <= 0 || bullets[i].y <= 1 || bullets[i].y >= HEIGHT - 1) {
-            bullets.erase(bullets.begin() + i); i--;
-        }
-    }
-
-    // Enemy/Boss Logic (2x speed)
-    for (int i = 0; i < (int)enemies.size(); i++) {
-        if (enemies[i].type == 1) { // Boss
-            if (enemies[i].x > WIDTH - 25) {
-                enemies[i].x -= max(2, (int)(1.6f * difficultyMultiplier)); // Doubled from 0.8
-            }
-            
-            // Boss shoots with smoother rate (2x speed)
-            int bossFireRate = max(13, (int)(23 - (difficultyMultiplier - 1.0f) * 3)); // Halved for faster shooting
-            if (frameCounter % bossFireRate == 0) {
-                bullets.push_back({ (float)enemies[i].x - 1, (float)enemies[i].y, false, 0 });
-                bullets.push_back({ (float)enemies[i].x - 1, (float)enemies[i].y, false, -1 });
-                bullets.push_back({ (float)enemies[i].x - 1, (float)enemies[i].y, false, 1 });
-            }
-            
-            // Boss tracks player smoothly (2x speed)
-            int bossTrackSpeed = max(2, (int)(2 - (difficultyMultiplier - 1.0f) * 0.15f)); // Halved for faster tracking
-            if (frameCounter % bossTrackSpeed == 0) {
-                if (playerY < enemies[i].y) enemies[i].y--;
-                else if (playerY > enemies[i].y) enemies[i].y++;
-            }
-        } else { // Small enemies (2x speed)
-            enemies[i].x -= max(2, (int)(2.6f * difficultyMultiplier)); // Doubled from 1.3
-        }
-
-        if (enemies[i].x <= 1) {
-            if(enemies[i].type == 0) { 
-                playerHP -= 5; 
-                PlayHitSound(); 
-                enemies.erase(enemies.begin() + i); 
-                i--; 
-            }
-            continue;
-        }
-
-        // Collision with player
-        if (abs(enemies[i].x - playerX) < 6 && abs(enemies[i].y - playerY) < 2) {
-            playerHP -= 10; 
-            PlayExplosionSound();
-            if(enemies[i].type == 0) { 
-                enemies.erase(enemies.begin() + i); 
-                i--; 
-            }
-        }
-    }
-
-    // Hit Detection
-    for (int i = 0; i < (int)bullets.size(); i++) {
-        bool bulletRemoved = false;
-        if (bullets[i].isPlayer) {
-            for (int j = 0; j < (int)enemies.size(); j++) {
-                if (bullets[i].x >= (float)enemies[j].x && 
-                    bullets[i].x <= (float)(enemies[j].x + 10) && 
-                    fabs(bullets[i].y - (float)enemies[j].y) < 2.0f) {
-                    
-                    if(enemies[j].type == 1) bossHP -= 2; 
-                    else enemies[j].hp--;
-                    
-                    bulletRemoved = true;
-                    
-                    if ((enemies[j].type == 1 && bossHP <= 0) || 
-                        (enemies[j].type == 0 && enemies[j].hp <= 0)) {
-                        if (enemies[j].type == 1) { 
-                            score += 100; 
-                            bossActive = false; 
-                            PlayExplosionSound(); 
-                        }
-                        else { 
-                            score += 5; 
-                            enemiesKilledForBoost++; 
-                        }
-                        
-                        if (enemiesKilledForBoost >= 10) { 
-                            boostPack.active = true; 
-                            boostPack.x = enemies[j].x; 
-                            boostPack.y = enemies[j].y; 
-                            enemiesKilledForBoost = 0; 
-                        }
-                        enemies.erase(enemies.begin() + j);
-                    }
-                    break; 
-                }
-            }
-        } else {
-            if (fabs(bullets[i].x - (float)playerX) < 4.0f && (int)bullets[i].y == playerY) {
-                playerHP -= 5; 
-                PlayHitSound(); 
-                bulletRemoved = true;
-            }
-        }
-        if (bulletRemoved) { 
-            bullets.erase(bullets.begin() + i); 
-            i--; 
-        }
-    }
-
-    // Power-up logic (2x speed)
-    if (boostPack.active) {
-        boostPack.x -= max(4, (int)(3.6f * difficultyMultiplier)); // Doubled from 2 and 1.8
-        if (abs(boostPack.x - playerX) < 5 && boostPack.y == playerY) { 
-            playerHP += 30; 
-            if(playerHP > 100) playerHP = 100; 
-            PlayPowerUpSound(); 
-            boostPack.active = false; 
-        }
-        if (boostPack.x <= 1) boostPack.active = false;
-    }
-
-    if (playerHP <= 0) gameRunning = false;
-}
-
-// ==========================================
-// 8. DRAWING
-// ==========================================
-
-void Draw() {
-    if (isPaused) {
-        Gotoxy(WIDTH / 2 - 5, HEIGHT / 2);
-        Color(RED);
-        cout << "*** PAUSED ***";
-        Color(WHITE);
-        return;
-    }
-    
-    Gotoxy(0, 0);
-    
-    // Clear board and add stars
-    for (int y = 0; y < HEIGHT; y++) {
-        for (int x = 0; x < WIDTH; x++) {
-            if (rand() % 200 == 0) board[y][x] = '.'; 
-            else board[y][x] = ' ';                
-        }
-    }
-
-    // Draw player
-    string pBody = "}==^==>";
-    for (int i = 0; i < (int)pBody.length(); i++) 
-        if (playerX + i < WIDTH) board[playerY][playerX + i] = pBody[i];
-    if (playerY > 0) board[playerY-1][playerX+2] = '\\'; 
-    if (playerY < HEIGHT - 1) board[playerY+1][playerX+2] = '/';
-
-    // Draw enemies
-    for (int k = 0; k < (int)enemies.size(); k++) {
-        int ex = enemies[k].x; 
-        int ey = enemies[k].y;
-        
-        if (enemies[k].type == 1) { // Boss
-            string bossBody = "[[[--MONSTER--]]]";
-            for(int i=0; i<(int)bossBody.length(); i++) 
-                if(ex+i < WIDTH && ex+i >= 0) board[ey][ex+i] = bossBody[i];
-            if(ey > 0 && ex+5 < WIDTH) board[ey-1][ex+5] = '/'; 
-            if(ey < HEIGHT - 1 && ex+5 < WIDTH) board[ey+1][ex+5] = '\\'; 
-        } else { // Small enemy
-            string eBody = "<==^=={";
-            for(int i=0; i<(int)eBody.length(); i++) 
-                if(ex+i < WIDTH && ex+i >= 0) board[ey][ex+i] = eBody[i];
-            if(ey > 0 && ex+3 < WIDTH) board[ey-1][ex+3] = '/'; 
-            if(ey < HEIGHT - 1 && ex+3 < WIDTH) board[ey+1][ex+3] = '\\'; 
-        }
-    }
-
-    // Draw bullets
-    for (int k = 0; k < (int)bullets.size(); k++) {
-        int bx = (int)bullets[k].x; 
-        int by = (int)bullets[k].y;
-        if (bx >= 0 && bx < WIDTH && by >= 0 && by < HEIGHT)
-            board[by][bx] = bullets[k].isPlayer ? '*' : 'o';
-    }
-    
-    // Draw power-up
-    if (boostPack.active && boostPack.x > 0 && boostPack.x < WIDTH) 
-        board[boostPack.y][boostPack.x] = 3;
-
-    // Render board
-    Color(CYAN);
-    for (int i = 0; i < WIDTH + 2; i++) cout << (char)178; 
-    cout << endl;
-    
-    for (int y = 0; y < HEIGHT; y++) {
-        Color(CYAN); 
-        cout << (char)178; 
-        
-        for (int x = 0; x < WIDTH; x++) {
-            char c = board[y][x];
-            
-            // Color selection
-            if (c == '}' || c == '^' || c == '>' || c == '\\' || c == '/') 
-                Color(GREEN); 
-            else if (c == '<' || c == '{') 
-                Color(RED); 
-            else if (c == '[' || c == '-' || c == 'M' || c == 'O' || c == 'N' || c == 'S') 
-                Color(MAGENTA);
-            else if ((unsigned char)c == 220) 
-                Color(DARKBROWN);
-            else if (c == '*') 
-                Color(YELLOW);
-            else if (c == 3) 
-                Color(RED);
-            else 
-                Color(WHITE);
-            
-            cout << c;
-        }
-        cout << endl; 
-    }
-    
-    Color(CYAN);
-    for (int i = 0; i < WIDTH + 2; i++) cout << (char)178; 
-    cout << endl;
-    
-    // Score Display
-    Color(YELLOW); 
-    cout << " SCORE: " << score << " ";
-    
-    // High Score Display
-    Color(MAGENTA);
-    cout << "| HIGH: " << highScore << " ";
-    
-    // Difficulty Display
-    Color(CYAN);
-    cout << "| SPEED: x" << fixed;
-    cout.precision(1);
-    cout << difficultyMultiplier << " ";
-    
-    // Health Bar with Percentage
-    Color(WHITE);  
-    cout << "| HP: ";
-    if (playerHP > 50) Color(GREEN); 
-    else if (playerHP > 30) Color(YELLOW); 
-    else Color(RED);
-    
-    int healthBarLength = (playerHP / 10);
-    cout << "[";
-    for (int i = 0; i < healthBarLength; i++) cout << (char)219;
-    for (int i = healthBarLength; i < 10; i++) cout << " ";
-    cout << "] " << playerHP << "%  ";
-    
-    // Bomb Status
-    Color(CYAN);   
-    cout << "| BOMB: " << (hasBomb ? "READY" : "----") << " ";
-    
-    // Boss Status
-    Color(MAGENTA); 
-    cout << "| BOSS: ";
-    if (bossActive) {
-        int bossBarLength = (bossHP / 10);
-        cout << "[";
-        for (int i = 0; i < bossBarLength; i++) cout << (char)219;
-        for (int i = bossBarLength; i < 10; i++) cout << " ";
-        cout << "]";
-    } else {
-        cout << "----";
-    }
-    cout << "   \r";
-}
-
-// ==========================================
-// 9. FRAME RATE CONTROL
-// ==========================================
-
-void FrameRateControl() {
-    auto currentTime = high_resolution_clock::now();
-    auto elapsed = duration_cast<milliseconds>(currentTime - lastFrameTime).count();
-    
-    if (elapsed < FRAME_TIME) {
-        Sleep(FRAME_TIME - elapsed);
-    }
-    
-    lastFrameTime = high_resolution_clock::now();
-}
-
-// ==========================================
-// 10. MAIN GAME LOOP
-// ==========================================
-
-int main() {
-    srand((unsigned int)time(0));
-    HideCursor();
-    
-    // Load high score
-    highScore = LoadHighScore();
-    
-    ShowMenu();
-    Setup();
-    
-    while (gameRunning) {
-        Input();
-        Logic();
-        Draw();
-        FrameRateControl(); // Smooth 60 FPS
-    }
-    
-    // Update high score if needed
-    bool isNewHighScore = false;
-    if (score > highScore) {
-        isNewHighScore = true;
-        UpdateHighScore();
-    }
-    
-    system("cls");
-    
-    if (isNewHighScore) {
-        PlayHighScoreSound();
-        Color(YELLOW);
-        cout << "\n\n\n\t\t ############################" << endl;
-        cout << "\t\t #   NEW HIGH SCORE!!!      #" << endl;
-        cout << "\t\t ############################" << endl;
-        Color(WHITE);
-        cout << "\n\t\t    Your Score: " << score << endl;
-        cout << "\t\t    Previous Best: " << (highScore - score + LoadHighScore()) << endl;
-    } else {
-        PlayExplosionSound();
-        Color(RED);
-        cout << "\n\n\n\t\t ############################" << endl;
-        cout << "\t\t #      MISSION FAILED      #" << endl;
-        cout << "\t\t ############################" << endl;
-        Color(WHITE);
-        cout << "\n\t\t    Your Score: " << score << endl;
-        cout << "\t\t    High Score: " << highScore << endl;
-    }
-    
-    Color(CYAN);
-    cout << "\n\n\t\t Press any key to exit...";
-    Color(WHITE);
-    _getch();
-    return 0;
-}
+#include <iostream>
+#include <vector>
+#include <string>
+#include <time.h>
+#include <cmath>
+#include <chrono>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+#include <memory>
+#include <new>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define BULLET_SIMD
+#endif
+
+#ifdef _WIN32
+#include <winsock2.h> // Before windows.h
+#include <ws2tcpip.h>
+#include <conio.h>
+#include <io.h>
+#include <windows.h>
+#ifdef _MSC_VER
+#pragma comment(lib, "ws2_32.lib") // MinGW: link with -lws2_32
+#endif
+#else
+#include <arpa/inet.h>
+#include <csignal>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <termios.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+using namespace std::chrono;
+
+// ==========================================
+// 1. GLOBAL SETTINGS & VARIABLES
+// ==========================================
+
+const int WIDTH = 90;
+const int HEIGHT = 26;
+const int TICK_RATE = 120; // Simulation ticks per second, doubled from 60 for 2x speed
+const long long TICK_NS = 1000000000LL / TICK_RATE;
+const int MAX_TICKS_PER_FRAME = 8; // Past this the game slows down rather than spiralling
+const int MAX_SKIPPED_RENDERS = 4; // Draw at least every few frames even when behind
+const string HIGH_SCORE_FILE = "highscore.dat"; // Legacy single score, imported once
+const string LEADERBOARD_FILE = "leaderboard.dat";
+const string QUICKSAVE_FILE = "quicksave.dat";
+const int SCREEN_WIDTH = 104; // Bordered board is WIDTH + 2, the HUD line is wider
+const int SCREEN_HEIGHT = 44; // Tallest page (How to play); the game uses HEIGHT + 4 rows
+const int PROFILER_ROW = HEIGHT + 3; // Under the HUD line
+
+// Color Codes
+const int BLUE = 9;
+const int GREEN = 10;
+const int CYAN = 11;
+const int RED = 12;
+const int MAGENTA = 13;
+const int YELLOW = 14;
+const int WHITE = 15;
+const int DARKBROWN = 6;
+
+// Per-tick key state, one bit per control
+const unsigned char KEY_UP = 1 << 0;
+const unsigned char KEY_DOWN = 1 << 1;
+const unsigned char KEY_LEFT = 1 << 2;
+const unsigned char KEY_RIGHT = 1 << 3;
+const unsigned char KEY_FIRE = 1 << 4;
+const unsigned char KEY_BOMB = 1 << 5;
+const unsigned char KEY_PAUSE = 1 << 6;
+const unsigned char KEY_QUIT = 1 << 7;
+
+const int NO_TIMER = -1;
+
+struct Object {
+    int x, y;
+    int hp;
+    int type; // 0 = Small Enemy, 1 = Monster
+    int id = 0; // Stable while the pools move entities around; timers target it
+    int fireTimer = NO_TIMER, trackTimer = NO_TIMER; // Boss cadences
+    int volley = 0; // Boss volleys fired, selects each pattern's step
+    int prevX = 0, prevY = 0; // Position at the start of the tick, for swept collision
+};
+
+struct PowerUp {
+    int x, y;
+    bool active;
+};
+
+int highScore = 0;
+vector<char> quicksave; // Saved game found at startup (see QUICKSAVE), empty if none
+
+// Fixed-capacity entity storage, sized once by reserve() before play starts
+// (the capacity comes from the arena). Removal moves the last element into
+// the hole, so it is O(1) and never allocates; a loop that removes element i
+// must revisit i.
+template <typename T>
+struct Pool {
+    vector<T> items;
+    int count = 0;
+
+    void reserve(int capacity) { items.assign(capacity, T()); count = 0; }
+    int capacity() const { return (int)items.size(); }
+    int size() const { return count; }
+    bool full() const { return count == capacity(); }
+    void clear() { count = 0; }
+    T& operator[](int i) { return items[i]; }
+    const T& operator[](int i) const { return items[i]; }
+    T* begin() { return items.data(); }
+    T* end() { return items.data() + count; }
+    const T* begin() const { return items.data(); }
+    const T* end() const { return items.data() + count; }
+
+    // Returns false (and drops the item) when the pool is full
+    bool push(const T& item) {
+        if (count == capacity()) return false;
+        items[count++] = item;
+        return true;
+    }
+
+    void remove(int i) { items[i] = items[--count]; }
+};
+
+// Row-major 2D cell buffer sized at runtime; plane[y][x] like a built-in array
+template <typename T>
+struct Plane {
+    vector<T> cells;
+    int width = 0, height = 0;
+
+    Plane() {}
+    Plane(int w, int h, T value) { Resize(w, h, value); }
+
+    void Resize(int w, int h, T value) {
+        width = w; height = h;
+        cells.assign((size_t)w * h, value);
+    }
+    void Fill(T value) { fill(cells.begin(), cells.end(), value); }
+    T* operator[](int y) { return cells.data() + (size_t)y * width; }
+    const T* operator[](int y) const { return cells.data() + (size_t)y * width; }
+};
+
+// Lock-free single-producer/single-consumer ring buffer for handing data
+// between the game thread and a worker thread
+template <typename T, int SIZE>
+struct SpscRing {
+    static_assert((SIZE & (SIZE - 1)) == 0, "SIZE must be a power of two");
+    T items[SIZE];
+    atomic<unsigned> head{0}; // Next slot to write, owned by the producer
+    atomic<unsigned> tail{0}; // Next slot to read, owned by the consumer
+
+    // Returns false when the ring is full
+    bool push(const T& item) {
+        unsigned h = head.load(memory_order_relaxed);
+        if (h - tail.load(memory_order_acquire) >= (unsigned)SIZE) return false;
+        items[h & (SIZE - 1)] = item;
+        head.store(h + 1, memory_order_release);
+        return true;
+    }
+
+    bool pop(T& item) {
+        unsigned t = tail.load(memory_order_relaxed);
+        if (t == head.load(memory_order_acquire)) return false;
+        item = items[t & (SIZE - 1)];
+        tail.store(t + 1, memory_order_release);
+        return true;
+    }
+
+    bool empty() const { return tail.load(memory_order_acquire) == head.load(memory_order_acquire); }
+};
+
+// Lock-free triple buffer: the producer always has a slot to write into and
+// the consumer always picks up the newest complete one. Neither side ever
+// waits for the other; a slot the consumer had no time for is overwritten.
+template <typename T>
+struct TripleBuffer {
+    static const int FRESH = 4; // Set in middle when it holds an unread slot
+    T slots[3];
+    atomic<int> middle{1}; // Slot index handed between the two sides
+    int back = 0;  // Owned by the producer
+    int front = 2; // Owned by the consumer
+
+    T& backSlot() { return slots[back]; }
+    const T& frontSlot() const { return slots[front]; }
+
+    // Producer: hands the back slot over; true if an unread slot was dropped
+    bool publish() {
+        int old = middle.exchange(back | FRESH, memory_order_acq_rel);
+        back = old & 3;
+        return (old & FRESH) != 0;
+    }
+
+    bool fresh() const { return (middle.load(memory_order_acquire) & FRESH) != 0; }
+
+    // Consumer: moves the newest slot to the front; false if nothing new
+    bool acquire() {
+        if (!fresh()) return false;
+        front = middle.exchange(front, memory_order_acq_rel) & 3;
+        return true;
+    }
+};
+
+// Two-level hashed timing wheel over simulation ticks. The inner wheel has a
+// slot per tick for the next 256 ticks, the outer one a slot per 256 ticks,
+// cascaded into the inner wheel as time reaches it. Timers are nodes on
+// intrusive lists in a fixed array, so scheduling and cancelling are O(1) and
+// never allocate. A timer is an event kind plus a target id rather than a
+// function pointer, so the wheel is plain data that can be saved with the game.
+template <int CAPACITY>
+struct TimerWheel {
+    static_assert(CAPACITY <= 256, "Handles keep the node index in the low 8 bits");
+    static const int INNER_BITS = 8;
+    static const int INNER = 1 << INNER_BITS;
+    static const int OUTER = 64;
+
+    struct Node {
+        long long due;
+        int period; // 0 for one-shot timers
+        int kind, target;
+        int prev, next, slot;
+        unsigned generation; // Bumped on release so stale handles miss
+    };
+
+    Node nodes[CAPACITY];
+    int head[INNER + OUTER], tail[INNER + OUTER];
+    int freeList;
+    long long now = 0;
+
+    void Clear() {
+        for (int s = 0; s < INNER + OUTER; s++) head[s] = tail[s] = -1;
+        for (int i = 0; i < CAPACITY; i++) {
+            nodes[i].next = i + 1 < CAPACITY ? i + 1 : -1;
+            nodes[i].slot = -1;
+            nodes[i].generation = 0; // Handles from before the clear are dropped by their owners
+        }
+        freeList = 0;
+        now = 0;
+    }
+
+    // Fires delay ticks from now (at least 1), then every period ticks if
+    // period > 0. Returns NO_TIMER when all nodes are in use.
+    int Schedule(int kind, int target, int delay, int period = 0) {
+        if (freeList < 0) return NO_TIMER;
+        int i = freeList;
+        freeList = nodes[i].next;
+        Node& n = nodes[i];
+        n.due = now + max(1, delay);
+        n.period = period;
+        n.kind = kind; n.target = target;
+        Link(i);
+        return Handle(i);
+    }
+
+    // Safe to call with NO_TIMER or a handle that already fired or was cancelled
+    bool Cancel(int handle) {
+        if (handle == NO_TIMER) return false;
+        int i = handle & 0xFF;
+        if (i >= CAPACITY || nodes[i].slot < 0 || Handle(i) != handle) return false;
+        Unlink(i);
+        Release(i);
+        return true;
+    }
+
+    // Runs every tick up to and including tick, calling fire(kind, target) for
+    // each timer that comes due, in the order the timers were scheduled
+    template <typename F>
+    void Advance(long long tick, F fire) {
+        while (now < tick) {
+            now++;
+            if ((now & (INNER - 1)) == 0) {
+                int s = INNER + (int)((now >> INNER_BITS) & (OUTER - 1));
+                for (int i; (i = head[s]) != -1;) {
+                    Unlink(i);
+                    Link(i);
+                }
+            }
+            // Anything scheduled or re-armed while firing lands in another slot
+            int s = (int)(now & (INNER - 1));
+            for (int i; (i = head[s]) != -1;) {
+                Unlink(i);
+                Node& n = nodes[i];
+                if (n.due != now) { Link(i); continue; } // Clamped far timer, not due yet
+                int kind = n.kind, target = n.target;
+                if (n.period > 0) {
+                    n.due += n.period;
+                    Link(i);
+                } else {
+                    Release(i);
+                }
+                fire(kind, target);
+            }
+        }
+    }
+
+    int Handle(int i) const {
+        return (int)((nodes[i].generation & 0x7FFFFF) << 8) | i; // Never negative, so never NO_TIMER
+    }
+
+    void Link(int i) {
+        Node& n = nodes[i];
+        long long delta = n.due - now;
+        if (delta < INNER) {
+            n.slot = (int)(n.due & (INNER - 1));
+        } else {
+            long long round = min(n.due >> INNER_BITS, (now >> INNER_BITS) + OUTER - 1);
+            n.slot = INNER + (int)(round & (OUTER - 1));
+        }
+        n.prev = tail[n.slot];
+        n.next = -1;
+        if (n.prev != -1) nodes[n.prev].next = i; else head[n.slot] = i;
+        tail[n.slot] = i;
+    }
+
+    void Unlink(int i) {
+        Node& n = nodes[i];
+        if (n.prev != -1) nodes[n.prev].next = n.next; else head[n.slot] = n.next;
+        if (n.next != -1) nodes[n.next].prev = n.prev; else tail[n.slot] = n.prev;
+        n.slot = -1;
+    }
+
+    void Release(int i) {
+        nodes[i].slot = -1;
+        nodes[i].generation++;
+        nodes[i].next = freeList;
+        freeList = i;
+    }
+};
+
+const int MAX_ENEMIES = 32;  // Boss + escorts + regular spawns peak around 20
+const int MAX_BOSS_ESCORTS = 6; // Fighters that arrive with a boss
+const int MAX_BULLETS = 256; // Per side
+
+// Bullets are kept structure-of-arrays, one stream per side, so the movement
+// and culling kernel is a straight pass over float arrays with no per-bullet
+// branching on the owner. Like Pool, the capacity is fixed by reserve().
+struct BulletStream {
+    vector<float> x;
+    vector<float> y;
+    vector<float> dx, dy; // Velocity, cells per tick
+    int count = 0;
+
+    void reserve(int capacity) {
+        x.assign(capacity, 0.0f); y.assign(capacity, 0.0f);
+        dx.assign(capacity, 0.0f); dy.assign(capacity, 0.0f);
+        count = 0;
+    }
+    int capacity() const { return (int)x.size(); }
+    int size() const { return count; }
+    bool full() const { return count == capacity(); }
+    void clear() { count = 0; }
+
+    bool push(float bx, float by, float bdx, float bdy) {
+        if (count == capacity()) return false;
+        x[count] = bx; y[count] = by; dx[count] = bdx; dy[count] = bdy;
+        count++;
+        return true;
+    }
+
+    void remove(int i) {
+        count--;
+        x[i] = x[count]; y[i] = y[count]; dx[i] = dx[count]; dy[i] = dy[count];
+    }
+};
+
+const float PLAYER_BULLET_SPEED = 6.0f;  // Doubled from 3.0
+const float PLAYER_BULLET_SPREAD = 0.5f; // Doubled from 0.25
+// Fastest an enemy bullet may fly, in cells per tick once difficulty has
+// scaled it: the built-in aimed burst at 2.5x. Anything quicker crosses the
+// board in about a tenth of a second and cannot be dodged; pattern speeds
+// above it are rejected, and scaling stops there.
+const float MAX_ENEMY_BULLET_SPEED = 8.0f;
+
+// Boss fire is data: each pattern is a volley of shots (fan or ring) that may
+// turn a little every volley (spirals) or be aimed at the player. Patterns are
+// parsed once at startup and expanded into velocity tables, so firing is a
+// bulk copy into the enemy bullet stream (see FireVolley).
+struct BulletPattern {
+    string name;
+    int hp;    // Fires while the boss is at or below this percentage of its HP
+    int shots; // Bullets per volley
+    int steps; // Volleys before the pattern repeats; each turns a little further
+    float speed; // Cells per tick before difficulty scaling
+    bool aimed;
+    int first; // Offset of the expanded velocities in patternDx/patternDy
+};
+
+// Periodic game events
+enum TimerKind {
+    TIMER_SPAWN,      // Regular enemy wave
+    TIMER_BOSS_FIRE,  // Target: boss id
+    TIMER_BOSS_TRACK, // Target: boss id
+};
+
+const int MAX_TIMERS = 64; // Spawn timer + two per boss, with room for more cadences
+
+// PCG32 generator. Each subsystem draws from its own stream, so e.g. visual
+// effects can never change what the simulation does with the same seed.
+struct Rng {
+    uint64_t state, inc;
+
+    void Seed(uint64_t seed, uint64_t stream) {
+        state = 0;
+        inc = (stream << 1) | 1;
+        Next();
+        state += seed;
+        Next();
+    }
+
+    uint32_t Next() {
+        uint64_t old = state;
+        state = old * 6364136223846793005ULL + inc;
+        uint32_t xorshifted = (uint32_t)(((old >> 18) ^ old) >> 27);
+        uint32_t rot = (uint32_t)(old >> 59);
+        return (xorshifted >> rot) | (xorshifted << ((0u - rot) & 31));
+    }
+
+    // 0 .. n-1
+    int Range(int n) { return (int)(Next() % (uint32_t)n); }
+};
+
+Rng rngVisual; // Starfield and other cosmetics, outside the simulation
+
+// Broadphase for bullet-vs-enemy hits: enemies are bucketed into grid cells one
+// board row high and GRID_CELL_WIDTH columns wide, so a bullet only tests the
+// enemies in its own column cell on the rows within hit range. An enemy is
+// linked into every column cell its hit box touches.
+const int ENEMY_HIT_WIDTH = 10; // Bullets hit an enemy anywhere in [x, x + 10]
+const int GRID_CELL_WIDTH = 16;
+const int MAX_ENEMY_STEP = 6;  // Enemies move at most max(2, (int)(2.6 * 2.5)) = 6 columns a tick
+const int MAX_BULLET_STEP = 6; // PLAYER_BULLET_SPEED, rounded up
+// With swept hits an enemy is linked into the cells its hit box swept through
+// during the tick (at most two rows, a boss tracks one row a tick), widened to
+// the right by one bullet step: a bullet that touched the box at any point in
+// the tick ends the tick in one of those columns, so lookups stay one column.
+const int GRID_NODES_PER_ENEMY = 2 * ((ENEMY_HIT_WIDTH + MAX_ENEMY_STEP + MAX_BULLET_STEP) / GRID_CELL_WIDTH + 2);
+
+// Arena size and entity limits. Interactive play, replays and batches use the
+// defaults; --stress overrides them to load-test the engine.
+struct Arena {
+    int width = WIDTH, height = HEIGHT;
+    int maxEnemies = MAX_ENEMIES; // Pool capacity
+    int maxBullets = MAX_BULLETS; // Per side
+    int enemyCap = 8;             // Regular spawns stop at this many enemies...
+    int bossEnemyCap = 12;        // ...or at this many while a boss is up
+    int spawnPerWave = 1;         // Enemies per spawn timer tick
+};
+
+// Everything one game's simulation reads and writes. Setup(), Input() and
+// Logic() work on an instance, so any number of games can run side by side
+// (see RunBatch); the interactive, headless and replay modes all use `game`.
+struct GameState {
+    int playerX, playerY;
+    int playerHP;
+    int score;
+    int enemiesKilledForBoost;
+    int triShotAmmo;
+    bool hasBomb;
+    int bossHP;
+    int maxBossHP;
+    bool bossActive;
+    int bossesKilled;
+    bool gameRunning;
+    bool isPaused;
+    unsigned char inputKeys; // Keys held this tick, fed to Input()
+    bool pauseKeyHeld, bombKeyHeld; // Edge detection for the toggle keys
+    int fireCooldown;
+    int prevPlayerX, prevPlayerY; // Position before this tick's Input()
+
+    // Second ship, two-player games only. It flies and fires on its own keys
+    // and shares the hull (playerHP), score and weapons with the first.
+    bool twoPlayers = false;
+    int wingX = 0, wingY = 0, prevWingX = 0, prevWingY = 0;
+    int wingFireCooldown = 0;
+    unsigned char wingKeys = 0; // Second player's keys this tick, fed to Input()
+
+    long long sweptHits = 0; // Hits the end-of-tick overlap test alone would have missed (not hashed)
+
+    Arena arena;
+    Pool<Object> enemies;
+    BulletStream playerBullets;
+    BulletStream enemyBullets;
+    PowerUp boostPack;
+
+    int frameCounter = 0; // Simulation ticks since Setup()
+
+    // Difficulty scaling
+    float difficultyMultiplier = 1.0f;
+    int lastScoreMilestone = 0;
+
+    TimerWheel<MAX_TIMERS> timers;
+    int spawnTimer = NO_TIMER;
+    int nextEnemyId = 0;
+
+    Rng rngSpawn; // Enemy spawn positions
+    Rng rngAI;    // Boss decisions
+
+    // Broadphase grid, rebuilt every tick
+    int gridColumns = 0;
+    vector<int> gridHead; // [row * gridColumns + column]
+    vector<int> gridNext;
+    vector<int> gridEnemy;
+
+    GameState() { Configure(Arena()); }
+
+    void Configure(const Arena& a);
+    void Seed(unsigned int seed);
+    void Setup();
+    void Input();
+    void Logic();
+    unsigned long long StateHash() const;
+
+    int ShipCount() const { return twoPlayers ? 2 : 1; }
+    int ShipX(int ship) const { return ship ? wingX : playerX; }
+    int ShipY(int ship) const { return ship ? wingY : playerY; }
+    int TargetShip() const;
+
+    void StartTimers();
+    void FlyShip(int& x, int& y, int& cooldown, unsigned char keys);
+    int GridColumn(int x) const;
+    void BuildEnemyGrid();
+    int FindHitEnemyBruteForce(float bx, float by, float dx, float dy) const;
+    int FindHitEnemy(float bx, float by, float dx, float dy) const;
+    bool PlayerSweepHits(int ship, float ox0, float oy0, float ox1, float oy1,
+                         float minX, float maxX, float minY, float maxY) const;
+    void RemoveDeadEnemies();
+    int SpawnEnemy(int x, int y, int hp, int type);
+    int FindEnemy(int id) const;
+    int SpawnInterval() const;
+    int BossFireInterval() const;
+    int BossTrackInterval() const;
+    void ArmTimer(int& handle, int kind, int target, int period);
+    void ArmBossTimers(Object& boss);
+    void SetDifficulty(float multiplier);
+    void AddScore(int points);
+    void FireTimer(int kind, int target);
+    void FireVolley(const BulletPattern& p, int step, float x, float y);
+};
+
+GameState game;
+
+// ==========================================
+// 2. CONSOLE BACKENDS
+// ==========================================
+
+// All terminal I/O goes through a Console. Output is batched: MoveTo(),
+// SetColor() and Write() only append to a buffer, and nothing reaches the
+// terminal until Flush(), so a frame or a whole screen is a single write.
+// Colors are console attributes (intensity|red|green|blue) and text is in
+// code page 437, as on the Windows console.
+
+// Maps a console attribute to an ANSI SGR color code
+int AnsiColor(int color) {
+    int ansi = ((color & 4) ? 1 : 0) | ((color & 2) ? 2 : 0) | ((color & 1) ? 4 : 0);
+    return ((color & 8) ? 90 : 30) + ansi;
+}
+
+class Console {
+public:
+    virtual ~Console() {}
+
+    virtual bool Open() { return true; }
+    virtual void Close() {}
+
+    // Gameplay keys currently held, as a KEY_* mask
+    virtual unsigned char PollKeys() { return 0; }
+    // True when a key press is waiting for ReadKey()
+    virtual bool KeyPressed() { return false; }
+    // Waits up to timeoutMs (forever if negative) for a key press without
+    // using the CPU; returns true when one is waiting for ReadKey()
+    virtual bool WaitForKey(int) { return KeyPressed(); }
+    // Next key press, blocks until there is one
+    virtual int ReadKey() { return 0; }
+
+    // Visible rows; pages taller than this are scrolled out instead of diffed
+    virtual int Rows() { return SCREEN_HEIGHT; }
+
+    // False on consoles that cannot take VT100 sequences; the renderer then
+    // uses WriteRegion() instead of cursor-addressed runs
+    virtual bool UsesEscapes() { return true; }
+
+    virtual void Clear() {
+        Write("\x1b[0m\x1b[2J\x1b[H");
+        currentColor = -1;
+    }
+
+    virtual void MoveTo(int x, int y) {
+        char seq[16];
+        out.append(seq, snprintf(seq, sizeof(seq), "\x1b[%d;%dH", y + 1, x + 1));
+    }
+
+    virtual void SetColor(int color) {
+        if (color == currentColor) return;
+        char seq[8];
+        out.append(seq, snprintf(seq, sizeof(seq), "\x1b[%dm", AnsiColor(color)));
+        currentColor = color;
+    }
+
+    // Writes a w x h block of cells in one go (legacy consoles only)
+    virtual void WriteRegion(int, int, int, int, const char*, const unsigned char*, int) {}
+
+    void Write(const char* text, size_t size) { out.append(text, size); }
+    void Write(const char* text) { out.append(text); }
+    void Put(char c) { out += c; }
+
+    void Flush() {
+        if (out.empty()) return;
+        Emit(out.data(), out.size());
+        out.clear();
+    }
+
+protected:
+    virtual void Emit(const char*, size_t) {}
+
+    string out;
+    int currentColor = -1;
+};
+
+// Headless runs: discards output and never reports keys
+class NullConsole : public Console {
+};
+
+#ifdef _WIN32
+class Win32Console : public Console {
+public:
+    bool Open() override {
+        hOut = GetStdHandle(STD_OUTPUT_HANDLE);
+        hIn = GetStdHandle(STD_INPUT_HANDLE);
+        // Windows 10+ consoles understand the same VT100 sequences as POSIX terminals.
+        // Older consoles fall back to direct console API calls.
+        DWORD mode = 0;
+        vt = GetConsoleMode(hOut, &mode) && SetConsoleMode(hOut, mode | ENABLE_VIRTUAL_TERMINAL_PROCESSING);
+        CONSOLE_CURSOR_INFO cursorInfo;
+        GetConsoleCursorInfo(hOut, &cursorInfo);
+        cursorInfo.bVisible = false;
+        SetConsoleCursorInfo(hOut, &cursorInfo);
+        return true;
+    }
+
+    unsigned char PollKeys() override {
+        unsigned char keys = 0;
+        if (GetAsyncKeyState(VK_UP) & 0x8000) keys |= KEY_UP;
+        if (GetAsyncKeyState(VK_DOWN) & 0x8000) keys |= KEY_DOWN;
+        if (GetAsyncKeyState(VK_LEFT) & 0x8000) keys |= KEY_LEFT;
+        if (GetAsyncKeyState(VK_RIGHT) & 0x8000) keys |= KEY_RIGHT;
+        if (GetAsyncKeyState(VK_SPACE) & 0x8000) keys |= KEY_FIRE;
+        if (GetAsyncKeyState('B') & 0x8000) keys |= KEY_BOMB;
+        if (GetAsyncKeyState('P') & 0x8000) keys |= KEY_PAUSE;
+        if (GetAsyncKeyState(VK_ESCAPE)) keys |= KEY_QUIT;
+        // Gameplay keys are read asynchronously; don't let them pile up for ReadKey()
+        FlushConsoleInputBuffer(hIn);
+        return keys;
+    }
+
+    bool KeyPressed() override { return _kbhit() != 0; }
+
+    bool WaitForKey(int timeoutMs) override {
+        auto deadline = steady_clock::now() + milliseconds(timeoutMs);
+        while (!_kbhit()) {
+            DWORD wait = INFINITE;
+            if (timeoutMs >= 0) {
+                long long left = duration_cast<milliseconds>(deadline - steady_clock::now()).count();
+                if (left <= 0) return false;
+                wait = (DWORD)left;
+            }
+            if (WaitForSingleObject(hIn, wait) != WAIT_OBJECT_0) return false;
+            // Woken by a record _kbhit() ignores (key release, mouse, focus): drop it
+            if (!_kbhit()) FlushConsoleInputBuffer(hIn);
+        }
+        return true;
+    }
+
+    int ReadKey() override { return _getch(); }
+    bool UsesEscapes() override { return vt; }
+
+    int Rows() override {
+        CONSOLE_SCREEN_BUFFER_INFO info;
+        if (!GetConsoleScreenBufferInfo(hOut, &info)) return SCREEN_HEIGHT;
+        return info.srWindow.Bottom - info.srWindow.Top + 1;
+    }
+
+    void Clear() override {
+        if (vt) {
+            Console::Clear();
+            return;
+        }
+        Flush();
+        CONSOLE_SCREEN_BUFFER_INFO info;
+        GetConsoleScreenBufferInfo(hOut, &info);
+        DWORD cells = info.dwSize.X * info.dwSize.Y, written = 0;
+        COORD home = { 0, 0 };
+        FillConsoleOutputCharacterA(hOut, ' ', cells, home, &written);
+        FillConsoleOutputAttribute(hOut, info.wAttributes, cells, home, &written);
+        SetConsoleCursorPosition(hOut, home);
+    }
+
+    void MoveTo(int x, int y) override {
+        if (vt) {
+            Console::MoveTo(x, y);
+            return;
+        }
+        Flush();
+        COORD coord = { (SHORT)x, (SHORT)y };
+        SetConsoleCursorPosition(hOut, coord);
+    }
+
+    void SetColor(int color) override {
+        if (vt) {
+            Console::SetColor(color);
+            return;
+        }
+        Flush();
+        SetConsoleTextAttribute(hOut, (WORD)color);
+    }
+
+    // One WriteConsoleOutput call for the whole block
+    void WriteRegion(int x, int y, int w, int h, const char* chars, const unsigned char* colors, int stride) override {
+        Flush();
+        cells.resize(w * h);
+        for (int row = 0; row < h; row++) {
+            for (int col = 0; col < w; col++) {
+                char c = chars[row * stride + col];
+                CHAR_INFO& cell = cells[row * w + col];
+                cell.Char.AsciiChar = c ? c : ' ';
+                cell.Attributes = c ? colors[row * stride + col] : WHITE;
+            }
+        }
+        COORD size = { (SHORT)w, (SHORT)h };
+        COORD origin = { 0, 0 };
+        SMALL_RECT region = { (SHORT)x, (SHORT)y, (SHORT)(x + w - 1), (SHORT)(y + h - 1) };
+        WriteConsoleOutputA(hOut, cells.data(), size, origin, &region);
+    }
+
+protected:
+    void Emit(const char* data, size_t size) override {
+        DWORD written = 0;
+        WriteConsoleA(hOut, data, (DWORD)size, &written, NULL);
+    }
+
+private:
+    HANDLE hOut = NULL, hIn = NULL;
+    bool vt = false;
+    vector<CHAR_INFO> cells;
+};
+#else
+// POSIX terminals: raw non-blocking termios input and VT100 output. Terminals
+// only report key presses (and auto-repeat), not releases, so a key counts as
+// held until KEY_HOLD_MS pass without another press or repeat of it.
+termios savedTerminal;
+
+// Ctrl+C still interrupts the game; put the terminal back before dying
+void RestoreTerminalOnSignal(int sig) {
+    tcsetattr(STDIN_FILENO, TCSANOW, &savedTerminal);
+    const char reset[] = "\x1b[0m\x1b[?25h\n";
+    if (write(STDOUT_FILENO, reset, sizeof(reset) - 1) < 0) {}
+    signal(sig, SIG_DFL);
+    raise(sig);
+}
+
+class PosixConsole : public Console {
+public:
+    bool Open() override {
+        if (tcgetattr(STDIN_FILENO, &savedTerminal) != 0) return false;
+        termios raw = savedTerminal;
+        raw.c_lflag &= ~(ICANON | ECHO); // Keep ISIG so Ctrl+C still works
+        raw.c_cc[VMIN] = 0;
+        raw.c_cc[VTIME] = 0;
+        tcsetattr(STDIN_FILENO, TCSANOW, &raw);
+        signal(SIGINT, RestoreTerminalOnSignal);
+        signal(SIGTERM, RestoreTerminalOnSignal);
+        opened = true;
+        Write("\x1b[?25l");
+        Flush();
+        return true;
+    }
+
+    void Close() override {
+        if (!opened) return;
+        Write("\x1b[0m\x1b[?25h");
+        Flush();
+        tcsetattr(STDIN_FILENO, TCSANOW, &savedTerminal);
+        signal(SIGINT, SIG_DFL);
+        signal(SIGTERM, SIG_DFL);
+        opened = false;
+    }
+
+    unsigned char PollKeys() override {
+        ReadInput();
+        pressCount = 0; // Gameplay consumes the presses
+        long long now = NowMs();
+        unsigned char keys = 0;
+        for (int bit = 0; bit < 8; bit++)
+            if (now - lastSeen[bit] < KEY_HOLD_MS) keys |= (unsigned char)(1 << bit);
+        return keys;
+    }
+
+    bool KeyPressed() override {
+        ReadInput();
+        return pressCount > 0;
+    }
+
+    bool WaitForKey(int timeoutMs) override {
+        auto deadline = steady_clock::now() + milliseconds(timeoutMs);
+        while (!KeyPressed()) {
+            int wait = -1;
+            if (timeoutMs >= 0) {
+                wait = (int)duration_cast<milliseconds>(deadline - steady_clock::now()).count();
+                if (wait <= 0) return false;
+            }
+            if (escState != 0 && (wait < 0 || wait > ESC_WAIT_MS)) wait = ESC_WAIT_MS; // Settle a pending ESC
+            pollfd pfd = { STDIN_FILENO, POLLIN, 0 };
+            poll(&pfd, 1, wait);
+        }
+        return true;
+    }
+
+    int Rows() override {
+        winsize size;
+        if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &size) != 0 || size.ws_row == 0) return SCREEN_HEIGHT;
+        return size.ws_row;
+    }
+
+    int ReadKey() override {
+        WaitForKey(-1);
+        int key = presses[0];
+        memmove(presses, presses + 1, (--pressCount) * sizeof(int));
+        return key;
+    }
+
+protected:
+    // Code page 437 glyphs used by the game, translated to UTF-8
+    void Emit(const char* data, size_t size) override {
+        utf8.clear();
+        for (size_t i = 0; i < size; i++) {
+            unsigned char c = (unsigned char)data[i];
+            switch (c) {
+                case 3:   utf8 += "\xe2\x99\xa5"; break; // Heart
+                case 178: utf8 += "\xe2\x96\x93"; break; // Dark shade
+                case 186: utf8 += "\xe2\x95\x91"; break; // Double vertical
+                case 187: utf8 += "\xe2\x95\x97"; break; // Double down and left
+                case 205: utf8 += "\xe2\x95\x90"; break; // Double horizontal
+                case 219: utf8 += "\xe2\x96\x88"; break; // Full block
+                default:  utf8 += c >= 128 ? '?' : (char)c;
+            }
+        }
+        const char* p = utf8.data();
+        size_t left = utf8.size();
+        while (left > 0) {
+            ssize_t n = write(STDOUT_FILENO, p, left);
+            if (n <= 0) break;
+            p += n; left -= n;
+        }
+    }
+
+private:
+    static const int KEY_HOLD_MS = 80; // Longer than the auto-repeat interval
+    static const int MAX_PRESSES = 16;
+    static const int ESC_WAIT_MS = 50; // A lone ESC only counts if nothing follows it by then
+
+    long long NowMs() {
+        return duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+    }
+
+    void Press(int key, unsigned char gameKey) {
+        if (gameKey) lastSeen[__builtin_ctz(gameKey)] = NowMs();
+        if (pressCount < MAX_PRESSES) presses[pressCount++] = key;
+    }
+
+    // One input byte; escape sequences are decoded across calls
+    void Decode(unsigned char c) {
+        if (escState == 1) {
+            if (c == '[' || c == 'O') {
+                escState = 2;
+                return;
+            }
+            escState = 0;
+            Press(27, KEY_QUIT); // ESC then an ordinary key
+        } else if (escState == 2) {
+            if ((c >= '0' && c <= '9') || c == ';') return; // Modifier parameters
+            escState = 0;
+            if (c == 'A') Press(224, KEY_UP);
+            else if (c == 'B') Press(224, KEY_DOWN);
+            else if (c == 'C') Press(224, KEY_RIGHT);
+            else if (c == 'D') Press(224, KEY_LEFT);
+            return;
+        }
+        if (c == 27) {
+            escState = 1;
+            escSince = NowMs();
+        } else if (c == ' ') {
+            Press(c, KEY_FIRE);
+        } else if (c == 'b' || c == 'B') {
+            Press(c, KEY_BOMB);
+        } else if (c == 'p' || c == 'P') {
+            Press(c, KEY_PAUSE);
+        } else {
+            Press(c, 0);
+        }
+    }
+
+    // Drains stdin without blocking. A sequence can be split across reads
+    // (buffer boundary, ssh), so a trailing ESC waits ESC_WAIT_MS for the rest.
+    void ReadInput() {
+        unsigned char buf[64];
+        ssize_t n;
+        while ((n = read(STDIN_FILENO, buf, sizeof(buf))) > 0) {
+            for (ssize_t i = 0; i < n; i++) Decode(buf[i]);
+        }
+        if (escState != 0 && NowMs() - escSince >= ESC_WAIT_MS) {
+            if (escState == 1) Press(27, KEY_QUIT);
+            escState = 0; // An unfinished sequence is dropped
+        }
+    }
+
+    bool opened = false;
+    long long lastSeen[8] = { -1000000, -1000000, -1000000, -1000000, -1000000, -1000000, -1000000, -1000000 };
+    int presses[MAX_PRESSES];
+    int pressCount = 0;
+    int escState = 0; // 1: after ESC, 2: inside ESC [ or ESC O
+    long long escSince = 0;
+    string utf8;
+};
+#endif
+
+NullConsole nullConsole;
+#ifdef _WIN32
+Win32Console systemConsole;
+#else
+PosixConsole systemConsole;
+#endif
+Console* console = &nullConsole;
+
+void CloseConsole() {
+    console->Flush();
+    console->Close();
+}
+
+// ==========================================
+// 3. HELPER FUNCTIONS
+// ==========================================
+
+void Color(int color) { console->SetColor(color); }
+void Gotoxy(int x, int y) { console->MoveTo(x, y); }
+
+void GameState::Seed(unsigned int seed) {
+    rngSpawn.Seed(seed, 1);
+    rngAI.Seed(seed, 2);
+}
+
+void SeedRandom(unsigned int seed) {
+    game.Seed(seed);
+    rngVisual.Seed(seed, 3);
+}
+
+const unsigned long long FNV_OFFSET = 14695981039346656037ULL;
+
+// FNV-1a, for state hashes and file checks
+unsigned long long HashBytes(unsigned long long h, const void* data, size_t size) {
+    const unsigned char* p = (const unsigned char*)data;
+    for (size_t i = 0; i < size; i++) { h ^= p[i]; h *= 1099511628211ULL; }
+    return h;
+}
+
+template <typename T>
+unsigned long long HashValue(unsigned long long h, const T& value) {
+    return HashBytes(h, &value, sizeof(value));
+}
+
+// Replaces path with the finished temporary file in one step
+bool ReplaceFile(const string& from, const string& to) {
+#ifdef _WIN32
+    return MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    return rename(from.c_str(), to.c_str()) == 0;
+#endif
+}
+
+// Writes header and body to path.tmp, syncs it to disk and renames it over
+// path, so a crash at any point leaves either the old file or the new one
+bool WriteFileSafely(const string& path, const void* header, size_t headerSize, const void* body, size_t bodySize) {
+    string temp = path + ".tmp";
+    FILE* file = fopen(temp.c_str(), "wb");
+    if (!file) return false;
+    bool ok = fwrite(header, 1, headerSize, file) == headerSize && fwrite(body, 1, bodySize, file) == bodySize &&
+              fflush(file) == 0;
+#ifdef _WIN32
+    ok = ok && _commit(_fileno(file)) == 0;
+#else
+    ok = ok && fsync(fileno(file)) == 0;
+#endif
+    ok = fclose(file) == 0 && ok;
+    if (!ok) {
+        remove(temp.c_str());
+        return false;
+    }
+    return ReplaceFile(temp, path);
+}
+
+// ==========================================
+// 4. LEADERBOARD
+// ==========================================
+
+// The best LEADERBOARD_SIZE runs. Lookups are served from the copy in
+// memory; after the load at startup the game thread never touches the disk.
+// A new entry queues a copy of the whole board for a writer thread, which
+// replaces the file with WriteFileSafely.
+//
+// File layout: LeaderboardHeader, then LEADERBOARD_SIZE LeaderboardEntry
+// records (the unused ones zeroed), checksummed in the header.
+
+const int LEADERBOARD_SIZE = 10;
+const uint32_t LEADERBOARD_VERSION = 1;
+
+struct LeaderboardHeader {
+    char magic[4];       // "NWLB"
+    uint32_t version;
+    uint32_t recordSize; // sizeof(LeaderboardEntry)
+    uint32_t count;      // Entries in use
+    uint64_t checksum;   // FNV-1a of every record
+};
+
+struct LeaderboardEntry {
+    int64_t timestamp; // Unix time the run ended, 0 if not known (imported)
+    int32_t score;
+    uint32_t ticks;    // Run length in simulation ticks
+};
+
+LeaderboardEntry leaderboard[LEADERBOARD_SIZE];
+int leaderboardCount = 0;
+
+// Writer thread hand-off, guarded by leaderboardMutex
+LeaderboardEntry leaderboardPending[LEADERBOARD_SIZE];
+int leaderboardPendingCount = 0;
+bool leaderboardDirty = false;
+bool leaderboardWriterRunning = false;
+mutex leaderboardMutex;
+condition_variable leaderboardWake;
+thread leaderboardWriter;
+atomic<int> leaderboardWriteErrors(0);
+
+uint64_t LeaderboardChecksum(const LeaderboardEntry* entries) {
+    return HashBytes(FNV_OFFSET, entries, sizeof(LeaderboardEntry) * LEADERBOARD_SIZE);
+}
+
+// Puts a run in its place on the board; returns its rank from 0, or -1 if it did not make it
+int InsertLeaderboardEntry(const LeaderboardEntry& entry) {
+    int rank = leaderboardCount;
+    while (rank > 0 && leaderboard[rank - 1].score < entry.score) rank--; // Ties keep the older run ahead
+    if (rank >= LEADERBOARD_SIZE) return -1;
+    int last = min(leaderboardCount, LEADERBOARD_SIZE - 1);
+    for (int i = last; i > rank; i--) leaderboard[i] = leaderboard[i - 1];
+    leaderboard[rank] = entry;
+    leaderboardCount = min(leaderboardCount + 1, LEADERBOARD_SIZE);
+    return rank;
+}
+
+// The score of the old single-score file becomes the first entry
+void ImportLegacyHighScore() {
+    ifstream file(HIGH_SCORE_FILE);
+    int score = 0;
+    if (file >> score && score > 0) InsertLeaderboardEntry({ 0, score, 0 });
+}
+
+// Startup only: reads the board, or imports the legacy high score when there is none
+void LoadLeaderboard() {
+    leaderboardCount = 0;
+    memset(leaderboard, 0, sizeof(leaderboard));
+    FILE* file = fopen(LEADERBOARD_FILE.c_str(), "rb");
+    if (!file) {
+        ImportLegacyHighScore();
+        return;
+    }
+    LeaderboardHeader header;
+    LeaderboardEntry entries[LEADERBOARD_SIZE];
+    bool ok = fread(&header, sizeof(header), 1, file) == 1 && fread(entries, sizeof(entries), 1, file) == 1 &&
+              memcmp(header.magic, "NWLB", 4) == 0 && header.version == LEADERBOARD_VERSION &&
+              header.recordSize == sizeof(LeaderboardEntry) && header.count <= (uint32_t)LEADERBOARD_SIZE &&
+              header.checksum == LeaderboardChecksum(entries);
+    fclose(file);
+    if (!ok) {
+        cerr << "Ignoring damaged leaderboard: " << LEADERBOARD_FILE << endl;
+        ImportLegacyHighScore();
+        return;
+    }
+    memcpy(leaderboard, entries, sizeof(entries));
+    leaderboardCount = (int)header.count;
+}
+
+bool WriteLeaderboard(const LeaderboardEntry* entries, int count) {
+    LeaderboardHeader header = { { 'N', 'W', 'L', 'B' }, LEADERBOARD_VERSION, sizeof(LeaderboardEntry),
+                                 (uint32_t)count, LeaderboardChecksum(entries) };
+    return WriteFileSafely(LEADERBOARD_FILE, &header, sizeof(header), entries, sizeof(LeaderboardEntry) * LEADERBOARD_SIZE);
+}
+
+void LeaderboardWriterLoop() {
+    LeaderboardEntry entries[LEADERBOARD_SIZE];
+    while (true) {
+        int count;
+        {
+            unique_lock<mutex> lock(leaderboardMutex);
+            leaderboardWake.wait(lock, [] { return leaderboardDirty || !leaderboardWriterRunning; });
+            if (!leaderboardDirty) break; // Stopped with everything written
+            memcpy(entries, leaderboardPending, sizeof(entries));
+            count = leaderboardPendingCount;
+            leaderboardDirty = false;
+        }
+        if (!WriteLeaderboard(entries, count)) leaderboardWriteErrors++;
+    }
+}
+
+void StartLeaderboardWriter() {
+    leaderboardWriterRunning = true;
+    leaderboardWriter = thread(LeaderboardWriterLoop);
+}
+
+// Returns once the last queued board is on disk
+void StopLeaderboardWriter() {
+    if (!leaderboardWriter.joinable()) return;
+    {
+        lock_guard<mutex> lock(leaderboardMutex);
+        leaderboardWriterRunning = false;
+    }
+    leaderboardWake.notify_one();
+    leaderboardWriter.join();
+    if (leaderboardWriteErrors > 0) cerr << "Cannot write leaderboard: " << LEADERBOARD_FILE << endl;
+}
+
+// Records a finished run; only a copy under the lock happens on the calling
+// thread. Returns the rank from 0, or -1.
+int SubmitRun(int score, uint32_t ticks) {
+    int rank = InsertLeaderboardEntry({ (int64_t)time(0), score, ticks });
+    if (rank < 0) return -1;
+    highScore = leaderboard[0].score;
+    {
+        lock_guard<mutex> lock(leaderboardMutex);
+        memcpy(leaderboardPending, leaderboard, sizeof(leaderboard));
+        leaderboardPendingCount = leaderboardCount;
+        leaderboardDirty = true;
+    }
+    leaderboardWake.notify_one();
+    return rank;
+}
+
+// Rank, score, date and run length, one row per entry; marked is flagged with "<"
+void PrintLeaderboard(ostream& out, const string& indent, int marked) {
+    out << indent << "RANK   SCORE       DATE   TIME\n";
+    for (int i = 0; i < leaderboardCount; i++) {
+        const LeaderboardEntry& e = leaderboard[i];
+        char date[16] = "-";
+        time_t when = (time_t)e.timestamp;
+        if (e.timestamp != 0) strftime(date, sizeof(date), "%Y-%m-%d", localtime(&when));
+        int seconds = (int)(e.ticks / TICK_RATE);
+        out << indent << setw(3) << i + 1 << setw(9) << e.score << setw(12) << date << setw(4) << seconds / 60 << ":"
+            << setfill('0') << setw(2) << seconds % 60 << setfill(' ') << (i == marked ? "  <" : "") << "\n";
+    }
+    if (leaderboardCount == 0) out << indent << "  (no runs yet)\n";
+}
+
+// ==========================================
+// 5. SOUNDS & MUSIC
+// ==========================================
+
+// Sounds are posted to a lock-free single-producer queue and played by a
+// worker thread, so Beep() never blocks the frame loop. A sound that is
+// already waiting in the queue is not queued again, and anything that has
+// waited longer than AUDIO_MAX_LATENCY_MS is dropped instead of played late.
+
+enum SoundId { SOUND_FIRE, SOUND_HIT, SOUND_EXPLOSION, SOUND_POWERUP, SOUND_MENU, SOUND_HIGHSCORE, SOUND_COUNT };
+
+enum AudioSink {
+    AUDIO_OFF,  // Nothing is queued at all
+    AUDIO_NULL, // Queue and worker run, tones are discarded
+    AUDIO_BEEP, // Win32 Beep() on the worker thread
+    AUDIO_WAV   // Tones are synthesized into a WAV file
+};
+
+struct Note {
+    int frequency, duration; // duration 0 ends the sound
+};
+
+const Note SOUND_NOTES[SOUND_COUNT][4] = {
+    { { 800, 5 } },                                            // Fire
+    { { 200, 10 } },                                           // Hit
+    { { 100, 30 } },                                           // Explosion
+    { { 1200, 20 }, { 1500, 20 } },                            // Power-up
+    { { 400, 50 } },                                           // Menu
+    { { 800, 100 }, { 1000, 100 }, { 1200, 100 }, { 1500, 200 } }, // High score
+};
+
+struct AudioCommand {
+    int sound;
+    long long postedAt; // steady_clock milliseconds
+};
+
+const int AUDIO_QUEUE_SIZE = 16; // Power of two
+const int AUDIO_MAX_LATENCY_MS = 100;
+const int WAV_SAMPLE_RATE = 22050;
+
+SpscRing<AudioCommand, AUDIO_QUEUE_SIZE> audioQueue;
+atomic<bool> soundPending[SOUND_COUNT];
+atomic<bool> audioRunning(false);
+thread audioThread;
+mutex audioWakeMutex;
+condition_variable audioWake;
+
+AudioSink audioSink = AUDIO_OFF;
+FILE* wavFile = NULL;
+unsigned wavDataBytes = 0;
+
+// Game thread counters
+int soundsPosted = 0, soundsCoalesced = 0, soundsDropped = 0;
+// Worker counters
+atomic<int> soundsPlayed(0), soundsStale(0);
+
+long long AudioClock() {
+    return duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+void WriteWavHeader() {
+    unsigned riffSize = 36 + wavDataBytes, fmtSize = 16, rate = WAV_SAMPLE_RATE;
+    unsigned short format = 1, channels = 1, blockAlign = 1, bits = 8;
+    fseek(wavFile, 0, SEEK_SET);
+    fwrite("RIFF", 1, 4, wavFile); fwrite(&riffSize, 4, 1, wavFile);
+    fwrite("WAVEfmt ", 1, 8, wavFile); fwrite(&fmtSize, 4, 1, wavFile);
+    fwrite(&format, 2, 1, wavFile); fwrite(&channels, 2, 1, wavFile);
+    fwrite(&rate, 4, 1, wavFile); fwrite(&rate, 4, 1, wavFile); // byte rate == sample rate at 8-bit mono
+    fwrite(&blockAlign, 2, 1, wavFile); fwrite(&bits, 2, 1, wavFile);
+    fwrite("data", 1, 4, wavFile); fwrite(&wavDataBytes, 4, 1, wavFile);
+    fseek(wavFile, 0, SEEK_END);
+}
+
+// 8-bit square wave, the closest match to the PC speaker Beep()
+void SynthesizeNote(const Note& note) {
+    static unsigned char samples[WAV_SAMPLE_RATE]; // Up to one second per note
+    int count = min(WAV_SAMPLE_RATE, WAV_SAMPLE_RATE * note.duration / 1000);
+    int halfPeriod = max(1, WAV_SAMPLE_RATE / (2 * note.frequency));
+    for (int i = 0; i < count; i++) samples[i] = ((i / halfPeriod) & 1) ? 96 : 160;
+    fwrite(samples, 1, count, wavFile);
+    wavDataBytes += count;
+}
+
+void PlayNotes(int sound) {
+    for (const Note& note : SOUND_NOTES[sound]) {
+        if (note.duration == 0) break;
+#ifdef _WIN32
+        if (audioSink == AUDIO_BEEP) Beep(note.frequency, note.duration);
+#else
+        if (audioSink == AUDIO_BEEP) this_thread::sleep_for(milliseconds(note.duration)); // No speaker here
+#endif
+        else if (audioSink == AUDIO_WAV) SynthesizeNote(note);
+    }
+    soundsPlayed++;
+}
+
+void AudioWorker() {
+    while (true) {
+        AudioCommand cmd;
+        if (!audioQueue.pop(cmd)) {
+            if (!audioRunning) break;
+            unique_lock<mutex> lock(audioWakeMutex);
+            audioWake.wait(lock, [] { return !audioQueue.empty() || !audioRunning; });
+            continue;
+        }
+        soundPending[cmd.sound].store(false, memory_order_release);
+        if (AudioClock() - cmd.postedAt > AUDIO_MAX_LATENCY_MS) soundsStale++;
+        else PlayNotes(cmd.sound);
+    }
+}
+
+// Passing through the mutex orders the push before the worker's predicate
+// check, so the worker can sleep with no timeout and never miss a sound.
+// The worker only holds it to check the queue, so this never waits long.
+void WakeAudio() {
+    { lock_guard<mutex> lock(audioWakeMutex); }
+    audioWake.notify_one();
+}
+
+// Called from the game thread only; never blocks on the audio output
+thread_local bool soundsMuted = false; // Netplay re-running ticks whose sounds already played
+
+void PostSound(int sound) {
+    if (audioSink == AUDIO_OFF || soundsMuted) return;
+    soundsPosted++;
+    if (soundPending[sound].exchange(true, memory_order_acq_rel)) {
+        soundsCoalesced++;
+        return;
+    }
+    if (!audioQueue.push({ sound, AudioClock() })) {
+        soundPending[sound].store(false, memory_order_release);
+        soundsDropped++;
+        return;
+    }
+    WakeAudio();
+}
+
+void StopAudio() {
+    if (!audioRunning) return;
+    audioRunning = false;
+    WakeAudio();
+    audioThread.join();
+    if (wavFile) {
+        WriteWavHeader();
+        fclose(wavFile);
+        wavFile = NULL;
+    }
+}
+
+bool StartAudio(AudioSink sink, const string& wavPath) {
+    audioSink = sink;
+    if (sink == AUDIO_OFF) return true;
+    if (sink == AUDIO_WAV) {
+        wavFile = fopen(wavPath.c_str(), "wb");
+        if (!wavFile) return false;
+        WriteWavHeader();
+    }
+    for (int i = 0; i < SOUND_COUNT; i++) soundPending[i] = false;
+    audioRunning = true;
+    audioThread = thread(AudioWorker);
+    atexit(StopAudio); // exit() from the menu must still join the worker
+    return true;
+}
+
+void PlayFireSound() { PostSound(SOUND_FIRE); }
+void PlayHitSound() { PostSound(SOUND_HIT); }
+void PlayExplosionSound() { PostSound(SOUND_EXPLOSION); }
+void PlayPowerUpSound() { PostSound(SOUND_POWERUP); }
+void PlayMenuSound() { PostSound(SOUND_MENU); }
+void PlayHighScoreSound() { PostSound(SOUND_HIGHSCORE); }
+
+// ==========================================
+// 6. GRAPHICS & MENU
+// ==========================================
+
+// Static screens are laid out once into pages, cell buffers the renderer
+// diffs against whatever is on screen, so switching screens only sends the
+// cells that differ and never clears the console.
+struct Page : streambuf {
+    char chars[SCREEN_HEIGHT][SCREEN_WIDTH];
+    unsigned char colors[SCREEN_HEIGHT][SCREEN_WIDTH];
+    int x = 0, y = 0, color = WHITE;
+    int rows = 0; // Rows with text on them
+
+    // Blank page, every cell a space so it covers whatever was shown before
+    void Reset() {
+        memset(chars, ' ', sizeof(chars));
+        memset(colors, WHITE, sizeof(colors));
+        x = 0; y = 0; color = WHITE;
+        rows = 0;
+    }
+
+    void MoveTo(int px, int py) { x = px; y = py; }
+    void SetColor(int c) { color = c; }
+
+    // Console-style text output: newlines and 8-column tab stops, clipped to the page
+    void Put(char c) {
+        if (c == '\n') {
+            x = 0; y++;
+        } else if (c == '\t') {
+            x = (x / 8 + 1) * 8;
+        } else {
+            if (x < SCREEN_WIDTH && y < SCREEN_HEIGHT) {
+                chars[y][x] = c;
+                colors[y][x] = (unsigned char)color;
+                rows = max(rows, y + 1);
+            }
+            x++;
+        }
+    }
+
+protected:
+    int overflow(int c) override {
+        if (c != EOF) Put((char)c);
+        return c;
+    }
+};
+
+Page menuPages[2]; // Logo in each blink color
+Page briefingPage;
+Page howToPage;
+Page gameOverPage; // Filled in when a game ends
+
+const int MENU_BLINK_MS = 600; // Logo color swap interval
+
+void DrawLogo(Page& page, bool blinkState) {
+    ostream out(&page);
+    page.MoveTo(0, 1);
+    if (blinkState) page.SetColor(CYAN); else page.SetColor(BLUE);
+    out << "\t    _   _ ___ _____ _   _ _____  _    _  ___  ______ \n";
+    out << "\t   | \\ | |_ _/  ___| | | |_   _|| |  | |/ _ \\ | ___ \\\n";
+    if (blinkState) page.SetColor(WHITE); else page.SetColor(RED);
+    out << "\t   |  \\| || |\\ `--. | |_| | | |  | |  | / /_\\ \\| |_/ /\n";
+    out << "\t   | . ` || | `--. \\|  _  | | |  | |/\\| |  _  ||    / \n";
+    if (blinkState) page.SetColor(CYAN); else page.SetColor(BLUE);
+    out << "\t   | |\\  || |/\\__/ /| | | | | |  \\  /\\  / | | || |\\ \\ \n";
+    out << "\t   \\_| \\_/\\_/\\____/ \\_| |_/ \\_/   \\/  \\/\\_| |_/\\_| \\_|\n";
+    page.SetColor(WHITE);
+    page.MoveTo(25, 10); out << "--- THE ULTIMATE WARRIOR ARCADE ---";
+}
+
+// Static part of the menu; only the logo changes while it is up
+void DrawMenuFrame(Page& page) {
+    ostream out(&page);
+    page.MoveTo(0, 0);
+    page.SetColor(CYAN);
+    for (int i = 0; i < 92; i++) out << (char)205;
+
+    // Display high score
+    page.MoveTo(32, 11);
+    page.SetColor(YELLOW);
+    out << "HIGH SCORE: " << highScore;
+
+    page.MoveTo(0, 12);
+    page.SetColor(CYAN);
+    for (int i = 0; i < 92; i++) out << (char)205;
+
+    for (int y = 13; y <= 21; y++) {
+        page.MoveTo(0, y);
+        page.SetColor(CYAN);
+        out << (char)186;
+        for (int i = 0; i < 90; i++) out << " ";
+        out << (char)186;
+    }
+
+    page.MoveTo(28, 14); page.SetColor(YELLOW); out << (char)187 << " 1. START MISSION " << (char)187;
+    page.MoveTo(28, 16); page.SetColor(WHITE);  out << (char)187 << " 2. MISSION BRIEFING " << (char)187;
+    page.MoveTo(28, 18); page.SetColor(CYAN);   out << (char)187 << " 3. HOW TO PLAY " << (char)187;
+    page.MoveTo(28, 20); page.SetColor(RED);    out << (char)187 << " 4. RETREAT (Exit) " << (char)187;
+    if (!quicksave.empty()) {
+        page.MoveTo(28, 13); page.SetColor(GREEN); out << (char)187 << " R. RESUME SAVED MISSION " << (char)187;
+    }
+
+    page.MoveTo(0, 22);
+    page.SetColor(CYAN);
+    for (int i = 0; i < 92; i++) out << (char)205;
+}
+
+void BuildMenuPages() {
+    for (int blink = 0; blink < 2; blink++) {
+        menuPages[blink].Reset();
+        DrawMenuFrame(menuPages[blink]);
+        DrawLogo(menuPages[blink], blink == 1);
+    }
+}
+
+void BuildBriefingPage(Page& page) {
+    ostream out(&page);
+    page.Reset();
+    page.SetColor(MAGENTA);
+    out << "\n";
+    for (int i = 0; i < 80; i++) out << "=";
+    out << "\n";
+    page.SetColor(CYAN);
+    out << "\t\t\t   *** MISSION BRIEFING ***\n";
+    page.SetColor(MAGENTA);
+    out << "\n";
+    for (int i = 0; i < 80; i++) out << "=";
+    out << "\n\n";
+    
+    page.SetColor(YELLOW);
+    out << "\t STATUS: CLASSIFIED TOP SECRET\n\n";
+    
+    page.SetColor(WHITE);
+    out << "\t OBJECTIVE:\n";
+    page.SetColor(GREEN);
+    out << "\t   Defend Earth against an alien invasion. Small enemy jets are attacking\n";
+    out << "\t   in waves, and a massive boss monster awaits at higher threat levels.\n";
+    out << "\t   When the boss appears, it brings fighter escorts to overwhelm defenses!\n\n";
+    
+    page.SetColor(WHITE);
+    out << "\t ENEMY INTEL:\n";
+    page.SetColor(RED);
+    out << "\t   - Red Jets: Fast-moving scouts (5 points each)\n";
+    out << "\t   - Purple Monster: Heavy Boss Unit (100 points)\n";
+    out << "\t   - Boss Escort: 4-6 fighter jets accompany each boss wave\n";
+    out << "\t   - During boss battles, additional fighters continue spawning\n\n";
+    
+    page.SetColor(WHITE);
+    out << "\t REWARD SYSTEM:\n";
+    page.SetColor(YELLOW);
+    out << "\t   - Eliminate 10 jets to earn a Health Boost Power-Up\n";
+    out << "\t   - Each boss defeated grants 100 points\n\n";
+    
+    page.SetColor(WHITE);
+    out << "\t SPECIAL WEAPONS:\n";
+    page.SetColor(MAGENTA);
+    out << "\t   - Tri-Shot Ammo: 60 rounds available when boss appears\n";
+    out << "\t   - Bomb Charge: Activate when boss is active (20 damage)\n\n";
+    
+    page.SetColor(MAGENTA);
+    for (int i = 0; i < 80; i++) out << "=";
+    out << "\n";
+    page.SetColor(WHITE);
+    out << "\n\t\t\t   Press any key to return to menu...";
+}
+
+void BuildHowToPage(Page& page) {
+    ostream out(&page);
+    page.Reset();
+    page.SetColor(MAGENTA);
+    out << "\n";
+    for (int i = 0; i < 80; i++) out << "=";
+    out << "\n";
+    page.SetColor(CYAN);
+    out << "\t\t\t      *** HOW TO PLAY ***\n";
+    page.SetColor(MAGENTA);
+    out << "\n";
+    for (int i = 0; i < 80; i++) out << "=";
+    out << "\n\n";
+    
+    page.SetColor(YELLOW);
+    out << "\t MOVEMENT:\n";
+    page.SetColor(WHITE);
+    out << "\t   UP ARROW    -> Move upward\n";
+    out << "\t   DOWN ARROW  -> Move downward\n";
+    out << "\t   LEFT ARROW  -> Move left\n";
+    out << "\t   RIGHT ARROW -> Move right\n\n";
+    
+    page.SetColor(YELLOW);
+    out << "\t COMBAT:\n";
+    page.SetColor(WHITE);
+    out << "\t   SPACEBAR -> Fire continuous beam at enemies\n";
+    out << "\t   B KEY    -> Activate bomb (when available & boss is active)\n";
+    out << "\t              - Bomb deals 20 damage to the boss\n\n";
+    
+    page.SetColor(YELLOW);
+    out << "\t GAME CONTROL:\n";
+    page.SetColor(WHITE);
+    out << "\t   P KEY   -> Pause/Resume game\n";
+    out << "\t   ESC KEY -> Save and quit (R on the menu resumes)\n\n";
+    
+    page.SetColor(YELLOW);
+    out << "\t GAME MECHANICS:\n";
+    page.SetColor(GREEN);
+    out << "\t   + Collect health boost power-ups to recover health (max: 100%)\n";
+    out << "\t   + Avoid enemy bullets or take damage\n";
+    out << "\t   + Your ship has a default health of 100%\n";
+    out << "\t   + Game ends when your health reaches 0%\n";
+    out << "\t   + Boss appears every 30 points with 4-6 fighter escorts\n";
+    out << "\t   + During boss battles, more fighters spawn continuously\n";
+    out << "\t   + Game speed increases every 20 points (up to 2.5x max)\n";
+    out << "\t   + High score is automatically saved to file\n\n";
+    
+    page.SetColor(YELLOW);
+    out << "\t TRI-SHOT WEAPON:\n";
+    page.SetColor(MAGENTA);
+    out << "\t   When active, spacebar fires 3 bullets instead of 1\n";
+    out << "\t   Available: 60 ammo rounds per boss encounter\n\n";
+    
+    page.SetColor(MAGENTA);
+    for (int i = 0; i < 80; i++) out << "=";
+    out << "\n";
+    page.SetColor(WHITE);
+    out << "\n\t\t\t   Press any key to return to menu...";
+}
+
+// Sizes every pool and the grid for the arena; only called between games
+void GameState::Configure(const Arena& a) {
+    arena = a;
+    enemies.reserve(arena.maxEnemies);
+    playerBullets.reserve(arena.maxBullets);
+    enemyBullets.reserve(arena.maxBullets);
+    gridColumns = (arena.width + ENEMY_HIT_WIDTH) / GRID_CELL_WIDTH + 1;
+    gridHead.assign((size_t)arena.height * gridColumns, -1);
+    gridNext.assign((size_t)arena.maxEnemies * GRID_NODES_PER_ENEMY, -1);
+    gridEnemy.assign(gridNext.size(), -1);
+}
+
+void GameState::Setup() {
+    playerX = 5; playerY = arena.height / 2 - (twoPlayers ? 4 : 0);
+    playerHP = 100; score = 0;
+    enemiesKilledForBoost = 0; triShotAmmo = 0;
+    hasBomb = false; bossActive = false; bossesKilled = 0;
+    boostPack.active = false; isPaused = false;
+    enemies.clear(); playerBullets.clear(); enemyBullets.clear();
+    gameRunning = true;
+    frameCounter = 0;
+    pauseKeyHeld = false; bombKeyHeld = false; fireCooldown = 0;
+    difficultyMultiplier = 1.0f;
+    lastScoreMilestone = 0;
+    nextEnemyId = 0;
+    prevPlayerX = playerX; prevPlayerY = playerY;
+    wingX = playerX; wingY = arena.height / 2 + 4;
+    prevWingX = wingX; prevWingY = wingY;
+    wingFireCooldown = 0; wingKeys = 0;
+    sweptHits = 0;
+    StartTimers();
+}
+
+// ==========================================
+// 7. INPUT HANDLING
+// ==========================================
+
+unsigned char SampleKeyboard() {
+    return console->PollKeys();
+}
+
+// Movement and gun of one ship
+void GameState::FlyShip(int& x, int& y, int& cooldown, unsigned char keys) {
+    // Smooth movement - responsive controls (2x speed)
+    int moveSpeed = 2; // Doubled from 1
+    if (keys & KEY_UP) y = max(2, y - moveSpeed);
+    if (keys & KEY_DOWN) y = min(arena.height - 3, y + moveSpeed);
+    if (keys & KEY_LEFT) x = max(1, x - moveSpeed);
+    if (keys & KEY_RIGHT) x = min(arena.width / 2, x + moveSpeed);
+
+    // Firing with cooldown for better performance
+    if (cooldown > 0) cooldown--;
+    
+    if (keys & KEY_FIRE) {
+        if (cooldown == 0) {
+            playerBullets.push((float)x + 7, (float)y, PLAYER_BULLET_SPEED, 0.0f);
+            if (triShotAmmo > 0) {
+                playerBullets.push((float)x + 7, (float)y, PLAYER_BULLET_SPEED, -PLAYER_BULLET_SPREAD);
+                playerBullets.push((float)x + 7, (float)y, PLAYER_BULLET_SPEED, PLAYER_BULLET_SPREAD);
+                triShotAmmo--;
+            }
+            PlayFireSound();
+            cooldown = 3; // Reduced from 5 for faster firing
+        }
+    }
+}
+
+void GameState::Input() {
+    prevPlayerX = playerX; prevPlayerY = playerY;
+    prevWingX = wingX; prevWingY = wingY;
+    unsigned char keys = twoPlayers ? inputKeys | wingKeys : inputKeys; // Either player can bomb or quit
+
+    // Check for pause key FIRST, only when P is pressed
+    if (inputKeys & KEY_PAUSE) {
+        if (!pauseKeyHeld) {
+            isPaused = !isPaused;
+            pauseKeyHeld = true;
+        }
+    } else {
+        pauseKeyHeld = false;
+    }
+    
+    if (isPaused) return;
+
+    // Check for bomb key
+    if (keys & KEY_BOMB) {
+        if (!bombKeyHeld && bossActive && hasBomb) {
+            bossHP -= 20; 
+            hasBomb = false;
+            PlayExplosionSound();
+            bombKeyHeld = true;
+        }
+    } else {
+        bombKeyHeld = false;
+    }
+
+    FlyShip(playerX, playerY, fireCooldown, inputKeys);
+    if (twoPlayers) FlyShip(wingX, wingY, wingFireCooldown, wingKeys);
+    
+    if (keys & KEY_QUIT) gameRunning = false;
+}
+
+// ==========================================
+// 8. GAME LOGIC
+// ==========================================
+
+int GameState::GridColumn(int x) const {
+    return min(gridColumns - 1, max(0, x / GRID_CELL_WIDTH));
+}
+
+// Narrowphase: the original AABB rule, at the end of the tick
+bool BulletHitsEnemy(float bx, float by, const Object& e) {
+    return bx >= (float)e.x && bx <= (float)(e.x + ENEMY_HIT_WIDTH) && fabs(by - (float)e.y) < 2.0f;
+}
+
+// Swept collision. A bullet moves up to 6 columns a tick and an enemy up to 6
+// the other way, more than the 10-column hit box, so testing overlap only at
+// the end of each tick lets fast pairs pass through each other. Instead the
+// relative motion over the tick is tested as a segment against the box (slab
+// method). Open box edges are pulled in by SWEEP_EPSILON; overlap at the end
+// of the tick is still tested with the exact original rules, so every hit the
+// discrete test found is still found.
+const float SWEEP_EPSILON = 1e-3f;
+
+// Clips [tEnter, tExit] to the times a coordinate moving from p by d lies in [lo, hi]
+bool SweepAxis(float p, float d, float lo, float hi, float& tEnter, float& tExit) {
+    if (max(p, p + d) < lo || min(p, p + d) > hi) return false; // Most pairs: no division needed
+    if (d == 0.0f) return true;
+    float t0 = (lo - p) / d, t1 = (hi - p) / d;
+    if (t0 > t1) swap(t0, t1);
+    tEnter = max(tEnter, t0);
+    tExit = min(tExit, t1);
+    return tEnter <= tExit;
+}
+
+// Earliest fraction of the tick at which a point moving from (x, y) by
+// (dx, dy) is inside the box, or -1 if it never is
+float SweepPointBox(float x, float y, float dx, float dy, float minX, float maxX, float minY, float maxY) {
+    float tEnter = 0.0f, tExit = 1.0f;
+    if (!SweepAxis(x, dx, minX, maxX, tEnter, tExit)) return -1.0f;
+    if (!SweepAxis(y, dy, minY, maxY, tEnter, tExit)) return -1.0f;
+    return tEnter;
+}
+
+// When during the tick a bullet that moved by (dx, dy) to (bx, by) first
+// touched the enemy, in the enemy's frame of reference; -1 for a miss
+float BulletHitTime(float bx, float by, float dx, float dy, const Object& e) {
+    float ex = (float)(e.x - e.prevX), ey = (float)(e.y - e.prevY);
+    float t = SweepPointBox(bx - dx - (float)e.prevX, by - dy - (float)e.prevY, dx - ex, dy - ey,
+                            0.0f, (float)ENEMY_HIT_WIDTH, -2.0f + SWEEP_EPSILON, 2.0f - SWEEP_EPSILON);
+    if (t < 0.0f && BulletHitsEnemy(bx, by, e)) t = 1.0f;
+    return t;
+}
+
+// A ship against an object that moved from (ox0, oy0) to (ox1, oy1), with the
+// box relative to the ship; the callers test end-of-tick overlap themselves
+bool GameState::PlayerSweepHits(int ship, float ox0, float oy0, float ox1, float oy1,
+                                float minX, float maxX, float minY, float maxY) const {
+    int x0 = ship ? prevWingX : prevPlayerX, y0 = ship ? prevWingY : prevPlayerY;
+    float x = ox0 - (float)x0, y = oy0 - (float)y0;
+    return SweepPointBox(x, y, ox1 - (float)ShipX(ship) - x, oy1 - (float)ShipY(ship) - y, minX, maxX, minY, maxY) >= 0.0f;
+}
+
+// The ship the boss aims at and follows; it switches every few seconds in two-player games
+int GameState::TargetShip() const {
+    return twoPlayers ? (frameCounter / (4 * TICK_RATE)) & 1 : 0;
+}
+
+void GameState::BuildEnemyGrid() {
+    fill(gridHead.begin(), gridHead.end(), -1);
+    int node = 0;
+    for (int j = 0; j < enemies.size(); j++) {
+        const Object& e = enemies[j];
+        if (e.hp <= 0) continue;
+        int rowLo = max(0, min(e.y, e.prevY)), rowHi = min(arena.height - 1, max(e.y, e.prevY));
+        int colLo = GridColumn(min(e.x, e.prevX));
+        int colHi = GridColumn(max(e.x, e.prevX) + ENEMY_HIT_WIDTH + MAX_BULLET_STEP);
+        for (int y = rowLo; y <= rowHi; y++) {
+            int* rowHead = &gridHead[(size_t)y * gridColumns];
+            for (int c = colLo; c <= colHi; c++) {
+                gridEnemy[node] = j;
+                gridNext[node] = rowHead[c];
+                rowHead[c] = node++;
+            }
+        }
+    }
+}
+
+// Reference path, kept for the collision benchmark
+int GameState::FindHitEnemyBruteForce(float bx, float by, float dx, float dy) const {
+    int best = -1;
+    float bestT = 2.0f;
+    for (int j = 0; j < enemies.size(); j++) {
+        if (enemies[j].hp <= 0) continue;
+        float t = BulletHitTime(bx, by, dx, dy, enemies[j]);
+        if (t >= 0.0f && t < bestT) { best = j; bestT = t; }
+    }
+    return best;
+}
+
+// Returns the live enemy the bullet touched first during the tick (lowest
+// index on a tie), exactly like the brute-force scan. The bullet must have
+// moved right by at most MAX_BULLET_STEP.
+int GameState::FindHitEnemy(float bx, float by, float dx, float dy) const {
+    int col = GridColumn((int)bx);
+    // |y - ey| < 2 only holds for rows floor(y) - 1 .. floor(y) + 2, for any y
+    // the bullet passed through; live bullets are at positive rows, so (int) is floor
+    float y0 = by - dy;
+    int rowLo = max(0, (int)min(y0, by) - 1);
+    int rowHi = min(arena.height - 1, (int)max(y0, by) + 2);
+    int best = -1;
+    float bestT = 2.0f;
+    for (int y = rowLo; y <= rowHi; y++) {
+        for (int n = gridHead[(size_t)y * gridColumns + col]; n != -1; n = gridNext[n]) {
+            int j = gridEnemy[n];
+            if (enemies[j].hp <= 0) continue;
+            float t = BulletHitTime(bx, by, dx, dy, enemies[j]);
+            if (t >= 0.0f && (t < bestT || (t == bestT && j < best))) { best = j; bestT = t; }
+        }
+    }
+    return best;
+}
+
+// Bullets live strictly inside these bounds
+inline bool BulletInArena(float x, float y, const Arena& arena) {
+    return x > 0.0f && x < (float)arena.width && y > 1.0f && y < (float)(arena.height - 1);
+}
+
+// Advances every bullet in the stream by its (dx, dy) and drops the ones that
+// were already outside the arena, compacting the survivors in the same pass.
+// A bullet that leaves during this tick is kept for it, so the hit sweep still
+// covers the stretch of its path that was inside (an enemy at the edge).
+void MoveBullets(BulletStream& s, const Arena& arena) {
+    float* sx = s.x.data();
+    float* sy = s.y.data();
+    float* sdx = s.dx.data();
+    float* sdy = s.dy.data();
+    int n = s.count, kept = 0, i = 0;
+#ifdef BULLET_SIMD
+    // Same bounds as BulletInArena()
+    const __m128 lowX = _mm_setzero_ps(), highX = _mm_set1_ps((float)arena.width);
+    const __m128 lowY = _mm_set1_ps(1.0f), highY = _mm_set1_ps((float)(arena.height - 1));
+    alignas(16) float nx[4], ny[4];
+    for (; i + 4 <= n; i += 4) {
+        // Unaligned loads: the streams are heap vectors with no alignment guarantee
+        __m128 ox = _mm_loadu_ps(sx + i), oy = _mm_loadu_ps(sy + i);
+        __m128 x = _mm_add_ps(ox, _mm_loadu_ps(sdx + i));
+        __m128 y = _mm_add_ps(oy, _mm_loadu_ps(sdy + i));
+        __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpgt_ps(ox, lowX), _mm_cmplt_ps(ox, highX)),
+                                   _mm_and_ps(_mm_cmpgt_ps(oy, lowY), _mm_cmplt_ps(oy, highY)));
+        int mask = _mm_movemask_ps(inside);
+        _mm_store_ps(nx, x);
+        _mm_store_ps(ny, y);
+        // kept <= i + k, so compaction never overwrites a lane not yet read
+        for (int k = 0; k < 4; k++) {
+            float bdx = sdx[i + k], bdy = sdy[i + k];
+            sx[kept] = nx[k]; sy[kept] = ny[k]; sdx[kept] = bdx; sdy[kept] = bdy;
+            kept += (mask >> k) & 1;
+        }
+    }
+#endif
+    for (; i < n; i++) {
+        bool inside = BulletInArena(sx[i], sy[i], arena);
+        float x = sx[i] + sdx[i], y = sy[i] + sdy[i], bdx = sdx[i], bdy = sdy[i];
+        sx[kept] = x; sy[kept] = y; sdx[kept] = bdx; sdy[kept] = bdy;
+        kept += inside;
+    }
+    s.count = kept;
+}
+
+// Order-preserving compaction of enemies killed during hit detection
+void GameState::RemoveDeadEnemies() {
+    int kept = 0;
+    for (int j = 0; j < enemies.size(); j++) {
+        if (enemies[j].hp > 0) {
+            enemies[kept++] = enemies[j];
+        } else {
+            timers.Cancel(enemies[j].fireTimer);
+            timers.Cancel(enemies[j].trackTimer);
+        }
+    }
+    enemies.count = kept;
+}
+
+// Returns the new enemy's index, or -1 when the pool is full
+int GameState::SpawnEnemy(int x, int y, int hp, int type) {
+    Object e = { x, y, hp, type };
+    e.id = ++nextEnemyId;
+    e.prevX = x; e.prevY = y;
+    return enemies.push(e) ? enemies.size() - 1 : -1;
+}
+
+int GameState::FindEnemy(int id) const {
+    for (int i = 0; i < enemies.size(); i++)
+        if (enemies[i].id == id) return i;
+    return -1;
+}
+
+// Event cadences in ticks; they only change with the difficulty
+int GameState::SpawnInterval() const {
+    return max(10, (int)(18 - (difficultyMultiplier - 1.0f) * 4)); // Halved for 2x speed
+}
+
+int GameState::BossFireInterval() const {
+    return max(13, (int)(23 - (difficultyMultiplier - 1.0f) * 3)); // Halved for faster shooting
+}
+
+int GameState::BossTrackInterval() const {
+    return max(2, (int)(2 - (difficultyMultiplier - 1.0f) * 0.15f)); // Halved for faster tracking
+}
+
+// (Re)arms a periodic timer on the ticks that are multiples of its period.
+// The phase comes from the wheel's own clock: the boss is armed after
+// frameCounter moved on but before the wheel caught up with it.
+void GameState::ArmTimer(int& handle, int kind, int target, int period) {
+    timers.Cancel(handle);
+    handle = timers.Schedule(kind, target, period - (int)(timers.now % period), period);
+}
+
+void GameState::ArmBossTimers(Object& boss) {
+    ArmTimer(boss.fireTimer, TIMER_BOSS_FIRE, boss.id, BossFireInterval());
+    ArmTimer(boss.trackTimer, TIMER_BOSS_TRACK, boss.id, BossTrackInterval());
+}
+
+void GameState::StartTimers() {
+    timers.Clear();
+    spawnTimer = NO_TIMER;
+    ArmTimer(spawnTimer, TIMER_SPAWN, 0, SpawnInterval());
+}
+
+// Difficulty only moves at score milestones, so the cadences are recomputed
+// and rescheduled here rather than every tick
+void GameState::SetDifficulty(float multiplier) {
+    difficultyMultiplier = multiplier;
+    ArmTimer(spawnTimer, TIMER_SPAWN, 0, SpawnInterval());
+    for (Object& e : enemies)
+        if (e.type == 1) ArmBossTimers(e);
+}
+
+void GameState::AddScore(int points) {
+    score += points;
+    // Progressive difficulty scaling - increases every 20 points
+    int currentMilestone = (score / 20) * 20;
+    if (currentMilestone > lastScoreMilestone) {
+        lastScoreMilestone = currentMilestone;
+        // Smoother increase: 12% every 20 points, capped at 2.5x speed
+        SetDifficulty(min(2.5f, difficultyMultiplier + 0.12f));
+    }
+}
+
+// Pattern table format: one pattern per line, '#' starts a comment.
+//   <name> <hp%> <shots> <spread deg> <speed> <turn deg per volley> <steps> <aimed 0|1>
+// Shots are spread evenly over the arc, centred on "straight at the left
+// edge" (or on the player when aimed); a spread of 360 makes a ring. Speeds are
+// cells per tick and scale with difficulty like the rest of the enemy fire.
+const char* DEFAULT_PATTERNS =
+    "# name   hp  shots spread speed turn steps aimed\n"
+    "classic 100    3    36    2.5     0    1     0\n"
+    "fan      66    7    90    2.0     0    1     0\n"
+    "spiral   40    6   360    1.6    12   30     0\n"
+    "aimed    20    5    24    3.2     0    1     1\n";
+
+vector<BulletPattern> bulletPatterns;
+vector<float> patternDx, patternDy; // Per pattern: steps x shots velocities
+
+bool ParseBulletPatterns(istream& in, string& error) {
+    const float DEG = 3.14159265f / 180.0f;
+    bulletPatterns.clear();
+    patternDx.clear();
+    patternDy.clear();
+    string line;
+    int lineNumber = 0;
+    while (getline(in, line)) {
+        lineNumber++;
+        size_t hash = line.find('#');
+        if (hash != string::npos) line.erase(hash);
+        istringstream words(line);
+        BulletPattern p;
+        float spread, speed, turn;
+        int aimed;
+        if (!(words >> p.name)) continue;
+        if (!(words >> p.hp >> p.shots >> spread >> speed >> turn >> p.steps >> aimed)
+            || p.shots <= 0 || p.steps <= 0 || speed <= 0.0f || speed > MAX_ENEMY_BULLET_SPEED) {
+            error = "line " + to_string(lineNumber) + ": bad pattern '" + p.name + "'";
+            return false;
+        }
+        p.speed = speed;
+        p.aimed = aimed != 0;
+        p.first = (int)patternDx.size();
+        // Angles are measured from straight left, positive turning down
+        float gap = spread >= 360.0f ? 360.0f / p.shots : (p.shots > 1 ? spread / (p.shots - 1) : 0.0f);
+        float start = spread >= 360.0f ? 0.0f : -spread / 2;
+        for (int step = 0; step < p.steps; step++) {
+            for (int k = 0; k < p.shots; k++) {
+                float angle = (start + k * gap + step * turn) * DEG;
+                patternDx.push_back(-speed * cos(angle));
+                patternDy.push_back(speed * sin(angle));
+            }
+        }
+        bulletPatterns.push_back(p);
+    }
+    if (bulletPatterns.empty()) error = "no patterns";
+    return !bulletPatterns.empty();
+}
+
+// The built-in table unless a file is given
+bool LoadBulletPatterns(const string& path, string& error) {
+    if (path.empty()) {
+        istringstream in(DEFAULT_PATTERNS);
+        return ParseBulletPatterns(in, error);
+    }
+    ifstream file(path);
+    if (!file.is_open()) {
+        error = "cannot read " + path;
+        return false;
+    }
+    return ParseBulletPatterns(file, error);
+}
+
+// Expands one volley into the enemy bullet stream: a rotation and scale
+// worked out once per volley, then straight-line fills of the preallocated
+// arrays. Shots that do not fit are dropped from the end.
+void GameState::FireVolley(const BulletPattern& p, int step, float x, float y) {
+    BulletStream& s = enemyBullets;
+    int n = min(p.shots, s.capacity() - s.count);
+    const float* vx = &patternDx[p.first + (step % p.steps) * p.shots];
+    const float* vy = &patternDy[p.first + (step % p.steps) * p.shots];
+    float scale = difficultyMultiplier;
+    if (p.speed * scale > MAX_ENEMY_BULLET_SPEED) scale = MAX_ENEMY_BULLET_SPEED / p.speed;
+    float c = scale, sn = 0.0f;
+    if (p.aimed) {
+        // Turn "straight left" (-1, 0) onto the direction of the player
+        float ax = (float)ShipX(TargetShip()) - x, ay = (float)ShipY(TargetShip()) - y;
+        float len = sqrt(ax * ax + ay * ay);
+        if (len > 0.0f) { c = -ax / len * scale; sn = -ay / len * scale; }
+    }
+    float* bx = s.x.data() + s.count;
+    float* by = s.y.data() + s.count;
+    float* bdx = s.dx.data() + s.count;
+    float* bdy = s.dy.data() + s.count;
+    for (int k = 0; k < n; k++) { bx[k] = x; by[k] = y; }
+    for (int k = 0; k < n; k++) {
+        bdx[k] = vx[k] * c - vy[k] * sn;
+        bdy[k] = vx[k] * sn + vy[k] * c;
+    }
+    s.count += n;
+}
+
+void GameState::FireTimer(int kind, int target) {
+    if (kind == TIMER_SPAWN) {
+        // Enemy spawning - smoother controlled rate (2x speed)
+        int cap = bossActive ? arena.bossEnemyCap : arena.enemyCap;
+        for (int k = 0; k < arena.spawnPerWave && enemies.size() < cap; k++)
+            SpawnEnemy(arena.width - 6, rngSpawn.Range(arena.height - 6) + 3, 1, 0);
+        return;
+    }
+
+    int i = FindEnemy(target);
+    if (i < 0) return;
+    Object& boss = enemies[i];
+    if (kind == TIMER_BOSS_FIRE) {
+        // More patterns join in as the boss weakens
+        int hpPercent = bossHP * 100 / max(1, maxBossHP);
+        for (const BulletPattern& p : bulletPatterns)
+            if (hpPercent <= p.hp) FireVolley(p, boss.volley, (float)boss.x - 1, (float)boss.y);
+        boss.volley++;
+    } else if (kind == TIMER_BOSS_TRACK) {
+        // Boss tracks player smoothly (2x speed)
+        int targetY = ShipY(TargetShip());
+        if (targetY < boss.y) boss.y--;
+        else if (targetY > boss.y) boss.y++;
+    }
+}
+
+void GameState::Logic() {
+    if (isPaused) return;
+
+    frameCounter++;
+    for (Object& e : enemies) { e.prevX = e.x; e.prevY = e.y; }
+
+    // Boss spawn logic; with the enemy pool full the boss stays due instead
+    int boss = score > 0 && score % 30 == 0 && !bossActive ? SpawnEnemy(arena.width - 20, arena.height / 2, 100, 1) : -1;
+    if (boss >= 0) {
+        bossActive = true; maxBossHP = 100; bossHP = maxBossHP;
+        ArmBossTimers(enemies[boss]);
+        triShotAmmo = 60; hasBomb = true; 
+        
+        // Spawn fighter jets along with the boss
+        int numFighters = 4 + rngAI.Range(MAX_BOSS_ESCORTS - 3); // 4 to 6 fighters
+        for (int f = 0; f < numFighters; f++) {
+            int spawnY = 3 + rngSpawn.Range(arena.height - 6);
+            int spawnX = arena.width - 10 - rngSpawn.Range(15);
+            SpawnEnemy(spawnX, spawnY, 1, 0);
+        }
+    }
+
+    // Waves, boss fire and boss tracking
+    timers.Advance(frameCounter, [this](int kind, int target) { FireTimer(kind, target); });
+
+    // Bullet Movement - optimized speeds (2x speed)
+    MoveBullets(playerBullets, arena);
+    MoveBullets(enemyBullets, arena);
+
+    // Enemy/Boss Logic (2x speed)
+    for (int i = 0; i < enemies.size(); i++) {
+        if (enemies[i].type == 1) { // Boss
+            if (enemies[i].x > arena.width - 25) {
+                enemies[i].x -= max(2, (int)(1.6f * difficultyMultiplier)); // Doubled from 0.8
+            }
+        } else { // Small enemies (2x speed)
+            enemies[i].x -= max(2, (int)(2.6f * difficultyMultiplier)); // Doubled from 1.3
+        }
+
+        if (enemies[i].x <= 1) {
+            if(enemies[i].type == 0) { 
+                playerHP -= 5; 
+                PlayHitSound(); 
+                enemies.remove(i); 
+                i--; 
+            }
+            continue;
+        }
+
+        // Collision with player
+        const Object& e = enemies[i];
+        bool touching = false;
+        for (int ship = 0; ship < ShipCount() && !touching; ship++) {
+            touching = abs(e.x - ShipX(ship)) < 6 && abs(e.y - ShipY(ship)) < 2;
+            if (!touching && PlayerSweepHits(ship, (float)e.prevX, (float)e.prevY, (float)e.x, (float)e.y,
+                                             -6.0f + SWEEP_EPSILON, 6.0f - SWEEP_EPSILON,
+                                             -2.0f + SWEEP_EPSILON, 2.0f - SWEEP_EPSILON)) {
+                touching = true;
+                sweptHits++;
+            }
+        }
+        if (touching) {
+            playerHP -= 10; 
+            PlayExplosionSound();
+            if(enemies[i].type == 0) { 
+                enemies.remove(i); 
+                i--; 
+            }
+        }
+    }
+
+    // Hit Detection
+    BuildEnemyGrid();
+    for (int i = 0; i < playerBullets.size(); i++) {
+        float bx = playerBullets.x[i], by = playerBullets.y[i];
+        int j = FindHitEnemy(bx, by, playerBullets.dx[i], playerBullets.dy[i]);
+        if (j < 0) continue;
+        if (!BulletHitsEnemy(bx, by, enemies[j])) sweptHits++;
+        
+        if(enemies[j].type == 1) bossHP -= 2; 
+        else enemies[j].hp--;
+        
+        if ((enemies[j].type == 1 && bossHP <= 0) || 
+            (enemies[j].type == 0 && enemies[j].hp <= 0)) {
+            if (enemies[j].type == 1) { 
+                AddScore(100);
+                bossesKilled++;
+                bossActive = false; 
+                PlayExplosionSound(); 
+            }
+            else { 
+                AddScore(5);
+                enemiesKilledForBoost++; 
+            }
+            
+            if (enemiesKilledForBoost >= 10) { 
+                boostPack.active = true; 
+                boostPack.x = enemies[j].x; 
+                boostPack.y = enemies[j].y; 
+                enemiesKilledForBoost = 0; 
+            }
+            enemies[j].hp = 0; // Removed after the loop so the grid stays valid
+        }
+        playerBullets.remove(i); 
+        i--; 
+    }
+    for (int i = 0; i < enemyBullets.size(); i++) {
+        float bx = enemyBullets.x[i], by = enemyBullets.y[i];
+        bool hit = false;
+        for (int ship = 0; ship < ShipCount() && !hit; ship++) {
+            hit = fabs(bx - (float)ShipX(ship)) < 4.0f && (int)by == ShipY(ship);
+            if (!hit && PlayerSweepHits(ship, bx - enemyBullets.dx[i], by - enemyBullets.dy[i], bx, by,
+                                        -4.0f + SWEEP_EPSILON, 4.0f - SWEEP_EPSILON, 0.0f, 1.0f - SWEEP_EPSILON)) {
+                hit = true;
+                sweptHits++;
+            }
+        }
+        if (hit) {
+            playerHP -= 5; 
+            PlayHitSound(); 
+            enemyBullets.remove(i); 
+            i--; 
+        }
+    }
+    RemoveDeadEnemies();
+
+    // Power-up logic (2x speed)
+    if (boostPack.active) {
+        int step = max(4, (int)(3.6f * difficultyMultiplier)); // Doubled from 2 and 1.8
+        boostPack.x -= step;
+        bool caught = false;
+        for (int ship = 0; ship < ShipCount() && !caught; ship++) {
+            caught = abs(boostPack.x - ShipX(ship)) < 5 && boostPack.y == ShipY(ship);
+            if (!caught && PlayerSweepHits(ship, (float)(boostPack.x + step), (float)boostPack.y, (float)boostPack.x,
+                                           (float)boostPack.y, -5.0f + SWEEP_EPSILON, 5.0f - SWEEP_EPSILON, 0.0f, 0.0f)) {
+                caught = true;
+                sweptHits++;
+            }
+        }
+        if (caught) { 
+            playerHP += 30; 
+            if(playerHP > 100) playerHP = 100; 
+            PlayPowerUpSound(); 
+            boostPack.active = false; 
+        }
+        if (boostPack.x <= 1) boostPack.active = false;
+    }
+
+    if (playerHP <= 0) gameRunning = false;
+}
+
+// ==========================================
+// 9. FRAME RENDERER
+// ==========================================
+
+// The game screen is the bordered board plus the HUD line underneath it.
+// Each frame is composed into the back planes, diffed against the front planes
+// (what the terminal is currently showing) and only the changed runs are sent,
+// batched into a single write.
+const int MAX_CELL_SKIP = 4; // Re-sending this many cells is cheaper than a cursor move
+
+// Everything the render thread needs to draw one game frame: the composited
+// board and the HUD values. The simulation thread fills one in and publishes
+// it; it is never written again until the renderer has let go of it.
+struct FrameSnapshot {
+    Plane<char> board;
+    Plane<unsigned char> colors; // Color of each board cell, written together with the glyph
+    int score, highScore, playerHP, bossHP;
+    float difficulty;
+    bool hasBomb, bossActive, paused;
+    char profileText[128]; // Profiler overlay line, empty when it is off
+};
+
+TripleBuffer<FrameSnapshot> frameBuffer; // Game loop -> render thread
+FrameSnapshot drawFrame; // Composed and drawn on the calling thread by Draw()
+
+// Screen sized by default; InitRenderer() grows them for larger arenas
+Plane<char> backChars(SCREEN_WIDTH, SCREEN_HEIGHT, 0);
+Plane<unsigned char> backColors(SCREEN_WIDTH, SCREEN_HEIGHT, WHITE);
+Plane<char> frontChars(SCREEN_WIDTH, SCREEN_HEIGHT, 0);
+Plane<unsigned char> frontColors(SCREEN_WIDTH, SCREEN_HEIGHT, WHITE);
+bool frontValid = false; // false forces the next frame to repaint every cell
+int shownRows = 0; // Rows the screen currently uses
+bool starfieldReady = false;
+
+void ResizeSnapshot(FrameSnapshot& f, const Arena& arena) {
+    f.board.Resize(arena.width, arena.height, ' ');
+    f.colors.Resize(arena.width, arena.height, WHITE);
+}
+
+// Sizes the snapshot boards and screen planes for game.arena
+void InitRenderer() {
+    const Arena& arena = game.arena;
+    if (drawFrame.board.width != arena.width || drawFrame.board.height != arena.height) {
+        ResizeSnapshot(drawFrame, arena);
+        for (FrameSnapshot& f : frameBuffer.slots) ResizeSnapshot(f, arena);
+        starfieldReady = false;
+    }
+    int w = max(SCREEN_WIDTH, arena.width + 2), h = max(SCREEN_HEIGHT, arena.height + 4);
+    if (backChars.width != w || backChars.height != h) {
+        backChars.Resize(w, h, 0);
+        backColors.Resize(w, h, WHITE);
+        frontChars.Resize(w, h, 0);
+        frontColors.Resize(w, h, WHITE);
+    }
+    frontValid = false;
+}
+
+// Call after anything else has written to the console (cls, ...)
+void InvalidateFrame() {
+    frontValid = false;
+}
+
+void ClearBackPlanes() {
+    backChars.Fill(0);
+    backColors.Fill(WHITE);
+}
+
+void AppendCell(int x, int y) {
+    console->SetColor(backColors[y][x]);
+    console->Put(backChars[y][x]);
+    frontChars[y][x] = backChars[y][x];
+    frontColors[y][x] = backColors[y][x];
+}
+
+// Legacy console path: one region write covering every changed cell
+void PresentRect(int minX, int minY, int maxX, int maxY) {
+    console->WriteRegion(minX, minY, maxX - minX + 1, maxY - minY + 1,
+                         &backChars[minY][minX], &backColors[minY][minX], backChars.width);
+    for (int y = minY; y <= maxY; y++) {
+        memcpy(&frontChars[y][minX], &backChars[y][minX], maxX - minX + 1);
+        memcpy(&frontColors[y][minX], &backColors[y][minX], maxX - minX + 1);
+    }
+}
+
+void PresentFrame() {
+    bool escapes = console->UsesEscapes();
+    int cursorX = -1, cursorY = -1;
+    int minX = backChars.width, minY = backChars.height, maxX = -1, maxY = -1;
+
+    for (int y = 0; y < backChars.height; y++) {
+        for (int x = 0; x < backChars.width; x++) {
+            char c = backChars[y][x];
+            if (c == 0) break; // Rest of the row is not part of the screen
+            if (frontValid && c == frontChars[y][x] && backColors[y][x] == frontColors[y][x]) continue;
+
+            if (!escapes) {
+                minX = min(minX, x); maxX = max(maxX, x);
+                minY = min(minY, y); maxY = max(maxY, y);
+                continue;
+            }
+
+            if (cursorY != y || x - cursorX > MAX_CELL_SKIP) {
+                console->MoveTo(x, y);
+            } else {
+                // Short gap: re-send the unchanged cells instead of moving the cursor
+                for (int gx = cursorX; gx < x; gx++) AppendCell(gx, y);
+            }
+            AppendCell(x, y);
+            cursorX = x + 1; cursorY = y;
+        }
+    }
+
+    if (!escapes && maxX >= 0) PresentRect(minX, minY, maxX, maxY);
+    console->Flush();
+    frontValid = true;
+}
+
+// Writes text into the back planes, returns the column after the last character
+int PutText(int x, int y, const char* text, int color) {
+    for (; *text && x < backChars.width; text++, x++) {
+        backChars[y][x] = *text;
+        backColors[y][x] = (unsigned char)color;
+    }
+    return x;
+}
+
+// Pages taller than the console are written out line by line and left to
+// scroll, like plain console output
+void StreamPage(const Page& page) {
+    console->Clear();
+    for (int y = 0; y < page.rows; y++) {
+        int end = SCREEN_WIDTH;
+        while (end > 0 && page.chars[y][end - 1] == ' ') end--;
+        for (int x = 0; x < end; x++) {
+            console->SetColor(page.colors[y][x]);
+            console->Put(page.chars[y][x]);
+        }
+        if (y + 1 < page.rows) console->Put('\n');
+    }
+    console->Flush();
+    InvalidateFrame();
+}
+
+// Shows a page, sending only the cells that differ from the current screen
+void ShowPage(const Page& page) {
+    int rows = max(page.rows, shownRows); // Blank what a taller screen left behind
+    if (rows > console->Rows()) {
+        StreamPage(page);
+        return;
+    }
+    if (!frontValid) console->Clear(); // Unknown screen contents
+    ClearBackPlanes();
+    for (int y = 0; y < rows; y++) {
+        memcpy(backChars[y], page.chars[y], SCREEN_WIDTH);
+        memcpy(backColors[y], page.colors[y], SCREEN_WIDTH);
+    }
+    PresentFrame();
+    shownRows = page.rows;
+}
+
+int PutBar(int x, int y, int filled, int color) {
+    x = PutText(x, y, "[", color);
+    int end = min(x + 10, backChars.width); // Clipped like PutText at narrow arenas
+    for (int i = 0; x + i < end; i++) {
+        backChars[y][x + i] = i < filled ? (char)219 : ' ';
+        backColors[y][x + i] = (unsigned char)color;
+    }
+    return end;
+}
+
+// ==========================================
+// 10. FRAME PROFILER
+// ==========================================
+
+// Per-phase frame timings on the monotonic clock. Rolling p50/p99/max over the
+// last PROFILE_WINDOW frames feed the overlay under the HUD; with a CSV path,
+// every frame is also handed through a lock-free ring to a writer thread.
+// The draw phase is the game loop's share of drawing (composing and publishing
+// the snapshot); the console write itself happens on the render thread.
+
+// Heap accounting: the global operator new is replaced so that allocations
+// made on a thread that opted in (the game thread) are counted. The counters
+// only ever grow; phases and frames are charged the difference since their
+// last mark, the same way as the timings.
+struct HeapCount {
+    long long allocations = 0, bytes = 0;
+};
+
+thread_local HeapCount* heapCounter = NULL; // Set on threads being counted
+HeapCount gameHeap; // Game thread
+
+void* operator new(size_t size) {
+    if (heapCounter) {
+        heapCounter->allocations++;
+        heapCounter->bytes += (long long)size;
+    }
+    while (true) {
+        void* p = malloc(size ? size : 1);
+        if (p) return p;
+        new_handler handler = get_new_handler();
+        if (!handler) throw bad_alloc();
+        handler();
+    }
+}
+void* operator new[](size_t size) { return operator new(size); }
+
+// GCC cannot see that new is replaced too when it inlines these into callers
+#if defined(__GNUC__) && __GNUC__ >= 11 && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+#if defined(__GNUC__) && __GNUC__ >= 11 && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+enum ProfilePhase { PHASE_INPUT, PHASE_LOGIC, PHASE_DRAW, PHASE_WAIT, PHASE_COUNT };
+
+struct FrameSample {
+    long long frame;
+    long long startUs; // Since the profiler started
+    int phaseUs[PHASE_COUNT];
+    int phaseAllocations[PHASE_COUNT];
+    long long allocatedBytes;
+    int ticks;
+    int enemies, playerBullets, enemyBullets;
+};
+
+struct PhaseStats {
+    double p50, p99, max; // milliseconds
+};
+
+const int PROFILE_WINDOW = 256;   // Frames in the rolling statistics
+const int PROFILE_REFRESH = 30;   // Frames between statistics updates
+const int PROFILE_BUSY = PHASE_COUNT; // Input + logic + draw, i.e. everything but waiting
+
+bool profilerEnabled = false;
+bool profilerOverlay = false;
+steady_clock::time_point profileStart;
+FrameSample currentFrame;
+int profileHistory[PHASE_COUNT + 1][PROFILE_WINDOW]; // Microseconds
+int profileFrames = 0;
+long long overBudgetFrames = 0;
+HeapCount heapMark; // gameHeap at the last phase mark
+
+// Game loop totals, kept whether or not the profiler runs
+HeapCount loopHeap, frameHeapMark;
+long long allocatingFrames = 0; // Frames that allocated on the game thread at all
+PhaseStats phaseStats[PHASE_COUNT + 1];
+
+SpscRing<FrameSample, 1024> profileQueue;
+long long profileSamplesDropped = 0;
+atomic<bool> profileWriterRunning(false);
+thread profileWriter;
+FILE* profileCsv = NULL;
+
+void ProfileWriterLoop() {
+    while (true) {
+        FrameSample f;
+        if (!profileQueue.pop(f)) {
+            if (!profileWriterRunning) break;
+            this_thread::sleep_for(milliseconds(20));
+            continue;
+        }
+        fprintf(profileCsv, "%lld,%.3f,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%lld\n", f.frame, f.startUs / 1000.0,
+                f.phaseUs[PHASE_INPUT], f.phaseUs[PHASE_LOGIC], f.phaseUs[PHASE_DRAW], f.phaseUs[PHASE_WAIT],
+                f.phaseUs[PHASE_INPUT] + f.phaseUs[PHASE_LOGIC] + f.phaseUs[PHASE_DRAW],
+                f.ticks, f.enemies, f.playerBullets, f.enemyBullets,
+                f.phaseAllocations[PHASE_INPUT], f.phaseAllocations[PHASE_LOGIC], f.phaseAllocations[PHASE_DRAW],
+                f.phaseAllocations[PHASE_WAIT], f.allocatedBytes);
+    }
+}
+
+bool StartProfiler(bool overlay, const string& csvPath) {
+    profilerEnabled = overlay || !csvPath.empty();
+    profilerOverlay = overlay;
+    profileStart = steady_clock::now();
+    currentFrame = FrameSample();
+    heapMark = gameHeap;
+    if (!csvPath.empty()) {
+        profileCsv = fopen(csvPath.c_str(), "w");
+        if (!profileCsv) return false;
+        fprintf(profileCsv, "frame,start_ms,input_us,logic_us,draw_us,wait_us,busy_us,ticks,enemies,player_bullets,enemy_bullets,"
+                            "input_allocs,logic_allocs,draw_allocs,wait_allocs,alloc_bytes\n");
+        profileWriterRunning = true;
+        profileWriter = thread(ProfileWriterLoop);
+    }
+    return true;
+}
+
+void StopProfiler() {
+    if (profileWriterRunning) {
+        profileWriterRunning = false;
+        profileWriter.join();
+    }
+    if (profileCsv) {
+        fclose(profileCsv);
+        profileCsv = NULL;
+        if (profileSamplesDropped > 0)
+            cerr << "Profiler: " << profileSamplesDropped << " frames not written (CSV writer fell behind)" << endl;
+    }
+}
+
+// Charges the time and allocations since mark to a phase of the current
+// frame and moves mark on
+void ProfilePhase(int phase, steady_clock::time_point& mark) {
+    if (!profilerEnabled) return;
+    auto now = steady_clock::now();
+    currentFrame.phaseUs[phase] += (int)duration_cast<microseconds>(now - mark).count();
+    mark = now;
+    currentFrame.phaseAllocations[phase] += (int)(gameHeap.allocations - heapMark.allocations);
+    currentFrame.allocatedBytes += gameHeap.bytes - heapMark.bytes;
+    heapMark = gameHeap;
+}
+
+void UpdatePhaseStats() {
+    static int sorted[PROFILE_WINDOW];
+    int n = min(profileFrames, PROFILE_WINDOW);
+    for (int p = 0; p <= PHASE_COUNT; p++) {
+        copy(profileHistory[p], profileHistory[p] + n, sorted);
+        nth_element(sorted, sorted + n / 2, sorted + n);
+        phaseStats[p].p50 = sorted[n / 2] / 1000.0;
+        int p99 = min(n - 1, n * 99 / 100);
+        nth_element(sorted, sorted + p99, sorted + n);
+        phaseStats[p].p99 = sorted[p99] / 1000.0;
+        phaseStats[p].max = *max_element(sorted, sorted + n) / 1000.0;
+    }
+}
+
+void ProfileEndFrame(steady_clock::time_point frameStart, int ticks) {
+    if (!profilerEnabled) return;
+    FrameSample& f = currentFrame;
+    f.startUs = duration_cast<microseconds>(frameStart - profileStart).count();
+    f.ticks = ticks;
+    f.enemies = game.enemies.size();
+    f.playerBullets = game.playerBullets.size();
+    f.enemyBullets = game.enemyBullets.size();
+
+    int busyUs = f.phaseUs[PHASE_INPUT] + f.phaseUs[PHASE_LOGIC] + f.phaseUs[PHASE_DRAW];
+    if (busyUs * 1000LL > TICK_NS) overBudgetFrames++;
+    int slot = profileFrames % PROFILE_WINDOW;
+    for (int p = 0; p < PHASE_COUNT; p++) profileHistory[p][slot] = f.phaseUs[p];
+    profileHistory[PROFILE_BUSY][slot] = busyUs;
+    profileFrames++;
+    if (profileFrames % PROFILE_REFRESH == 0) UpdatePhaseStats();
+
+    if (profileCsv && !profileQueue.push(f)) profileSamplesDropped++;
+    long long next = f.frame + 1;
+    f = FrameSample();
+    f.frame = next;
+}
+
+// Starts heap accounting afresh, leaving out whatever was allocated between frames
+void MarkHeap() {
+    heapMark = frameHeapMark = gameHeap;
+}
+
+void EndHeapFrame() {
+    long long allocations = gameHeap.allocations - frameHeapMark.allocations;
+    if (allocations > 0) allocatingFrames++;
+    loopHeap.allocations += allocations;
+    loopHeap.bytes += gameHeap.bytes - frameHeapMark.bytes;
+    frameHeapMark = gameHeap;
+}
+
+// Formatted on the simulation thread, which owns the statistics
+void FormatProfilerOverlay(char* text, size_t size) {
+    const PhaseStats& b = phaseStats[PROFILE_BUSY];
+    const PhaseStats& l = phaseStats[PHASE_LOGIC];
+    const PhaseStats& d = phaseStats[PHASE_DRAW];
+    snprintf(text, size, " FRAME %.2f/%.2f/%.2f ms | LOGIC %.2f/%.2f/%.2f | DRAW %.2f/%.2f/%.2f | OVER %lld | ALLOC %lld | E%d B%d",
+             b.p50, b.p99, b.max, l.p50, l.p99, l.max, d.p50, d.p99, d.max,
+             overBudgetFrames, allocatingFrames, game.enemies.size(), game.playerBullets.size() + game.enemyBullets.size());
+}
+
+void DrawProfilerOverlay(const char* text) {
+    int y = PROFILER_ROW;
+    int x = PutText(0, y, text, DARKBROWN);
+    for (; x < SCREEN_WIDTH; x++) { backChars[y][x] = ' '; backColors[y][x] = WHITE; }
+}
+
+// ==========================================
+// 11. SCREEN CAPTURE
+// ==========================================
+
+// A capture is the sequence of frames the game actually showed, with their
+// times, for reviewing sessions and stutters afterwards (see RunWatch). The
+// game thread codes each published snapshot against the previous one into a
+// block buffer; a writer thread takes full blocks, entropy codes them and
+// does the file I/O.
+//
+// Every frame gets a record with its time, so stutters show at full
+// resolution, but the board is only stored at the capture frame rate (30 fps
+// by default); the frames in between are timing-only records.
+//
+// Frame records:
+//   kind byte: 'K' keyframe, 'D' delta or 'T' timing only
+//   LEB128 time in microseconds and LEB128 tick: absolute for keyframes,
+//   since the previous frame otherwise; a 'T' record ends here
+//   keyframes only: 8-byte hash of the board the frame before left, 0 if unknown
+//   HUD mask byte, then each HUD field whose bit is set (ints zigzag LEB128,
+//   difficulty as a raw float, flags as a byte)
+//   cell tokens, LEB128 (n << 1 | run), ended by a 0: a skip token leaves n
+//   cells as they were, a run token is followed by glyph and color and sets n
+// Keyframes are coded against an empty board, so playback can start at any of them.
+//
+// File layout: CaptureHeader, then per block its raw and packed sizes (uint32)
+// and the records range coded with an adaptive order-1 byte model that
+// carries over from block to block.
+
+struct CaptureHeader {
+    char magic[4];          // "NWCP"
+    uint32_t version;
+    uint32_t width, height; // Board size
+};
+
+const uint32_t CAPTURE_VERSION = 1;
+const long long CAPTURE_KEYFRAME_US = 2000000;     // Seek granularity
+const int CAPTURE_DEFAULT_FPS = 30;
+const size_t CAPTURE_BLOCK_BYTES = 64 * 1024;      // Handed to the writer when this full
+const size_t CAPTURE_MAX_PENDING = 4 * 1024 * 1024; // Past this, frames are dropped instead of queued
+
+// LZMA-style binary range coder; a byte is coded as 8 adaptive bit decisions
+// in the context of the byte before it
+const int RC_PROB_BITS = 11, RC_MOVE_BITS = 5;
+const uint32_t RC_TOP = 1u << 24;
+
+struct ByteModel {
+    uint16_t probs[256][256];
+    unsigned char previous = 0;
+    void Reset() {
+        for (auto& row : probs) fill(row, row + 256, (uint16_t)(1 << (RC_PROB_BITS - 1)));
+        previous = 0;
+    }
+};
+
+struct RangeEncoder {
+    vector<unsigned char>* out = NULL;
+    uint64_t low = 0;
+    uint32_t range = 0xFFFFFFFF;
+    unsigned char cache = 0;
+    uint64_t cacheSize = 1;
+
+    void ShiftLow() {
+        if ((uint32_t)low < 0xFF000000u || (low >> 32) != 0) {
+            unsigned char carry = (unsigned char)(low >> 32), pending = cache;
+            do {
+                out->push_back((unsigned char)(pending + carry));
+                pending = 0xFF;
+            } while (--cacheSize != 0);
+            cache = (unsigned char)(low >> 24);
+        }
+        cacheSize++;
+        low = (low & 0x00FFFFFF) << 8;
+    }
+    void Bit(uint16_t& prob, int bit) {
+        uint32_t bound = (range >> RC_PROB_BITS) * prob;
+        if (bit) { low += bound; range -= bound; prob -= prob >> RC_MOVE_BITS; }
+        else { range = bound; prob += ((1 << RC_PROB_BITS) - prob) >> RC_MOVE_BITS; }
+        while (range < RC_TOP) { range <<= 8; ShiftLow(); }
+    }
+    void Byte(ByteModel& model, unsigned char value) {
+        uint16_t* probs = model.probs[model.previous];
+        for (int node = 1, i = 7; i >= 0; i--) {
+            int bit = (value >> i) & 1;
+            Bit(probs[node], bit);
+            node = node * 2 + bit;
+        }
+        model.previous = value;
+    }
+    // Codes a whole block and flushes, leaving the coder ready for the next one
+    void Block(ByteModel& model, const vector<unsigned char>& raw, vector<unsigned char>& packed) {
+        out = &packed;
+        low = 0; range = 0xFFFFFFFF; cache = 0; cacheSize = 1;
+        for (unsigned char c : raw) Byte(model, c);
+        for (int i = 0; i < 5; i++) ShiftLow();
+    }
+};
+
+struct RangeDecoder {
+    const unsigned char *p, *end;
+    uint32_t range = 0xFFFFFFFF, code = 0;
+
+    RangeDecoder(const unsigned char* begin, const unsigned char* finish) : p(begin), end(finish) {
+        for (int i = 0; i < 5; i++) code = (code << 8) | Next();
+    }
+    unsigned char Next() { return p < end ? *p++ : 0; }
+    int Bit(uint16_t& prob) {
+        uint32_t bound = (range >> RC_PROB_BITS) * prob;
+        int bit = code >= bound;
+        if (bit) { code -= bound; range -= bound; prob -= prob >> RC_MOVE_BITS; }
+        else { range = bound; prob += ((1 << RC_PROB_BITS) - prob) >> RC_MOVE_BITS; }
+        while (range < RC_TOP) { range <<= 8; code = (code << 8) | Next(); }
+        return bit;
+    }
+    unsigned char Byte(ByteModel& model) {
+        uint16_t* probs = model.probs[model.previous];
+        int node = 1;
+        while (node < 256) node = node * 2 + Bit(probs[node]);
+        model.previous = (unsigned char)node;
+        return (unsigned char)node;
+    }
+};
+
+enum CaptureHudField { HUD_SCORE, HUD_HIGH_SCORE, HUD_PLAYER_HP, HUD_BOSS_HP, HUD_DIFFICULTY, HUD_FLAGS, HUD_FIELDS };
+
+bool capturing = false;
+Plane<char> captureChars;           // The board as the capture has it so far
+Plane<unsigned char> captureColors;
+FrameSnapshot captureHud;           // HUD values of the last captured frame
+steady_clock::time_point captureStart, captureLastFrame, captureLastKey, captureLastContent;
+long long captureContentUs = 0;     // Time between stored boards, 0 stores every frame
+long long captureLastTick = 0;
+bool captureNeedsKey = true;
+long long captureFrames = 0, captureFramesDropped = 0;
+int captureBlockFrames = 0;         // Frames coded into captureBlock
+vector<unsigned char> captureBlock;  // Being coded into by the game thread
+vector<unsigned char> captureQueued; // Handed to the writer, guarded by captureMutex
+mutex captureMutex;
+condition_variable captureWake;
+bool captureWriterRunning = false;   // Guarded by captureMutex
+thread captureWriter;
+FILE* captureFile = NULL;
+
+void PutVarint(vector<unsigned char>& out, unsigned long long n) {
+    do {
+        out.push_back((unsigned char)((n & 0x7F) | (n > 0x7F ? 0x80 : 0)));
+        n >>= 7;
+    } while (n);
+}
+
+bool GetVarint(const unsigned char*& p, const unsigned char* end, unsigned long long& n) {
+    n = 0;
+    for (int shift = 0; p < end && shift < 64; shift += 7) {
+        unsigned char c = *p++;
+        n |= (unsigned long long)(c & 0x7F) << shift;
+        if (!(c & 0x80)) return true;
+    }
+    return false;
+}
+
+unsigned long long ZigZag(int value) {
+    return ((unsigned long long)(unsigned int)value << 1) ^ (unsigned long long)(long long)(value >> 31);
+}
+
+int UnZigZag(unsigned long long n) {
+    return (int)(n >> 1) ^ -(int)(n & 1);
+}
+
+unsigned char HudFlags(const FrameSnapshot& f) {
+    return (unsigned char)(f.hasBomb | f.bossActive << 1 | f.paused << 2);
+}
+
+unique_ptr<ByteModel> captureModel; // Owned by the writer thread while it runs
+RangeEncoder captureEncoder;
+vector<unsigned char> capturePacked;
+
+void WriteCaptureBlock(const vector<unsigned char>& raw) {
+    capturePacked.clear();
+    captureEncoder.Block(*captureModel, raw, capturePacked);
+    uint32_t sizes[2] = { (uint32_t)raw.size(), (uint32_t)capturePacked.size() };
+    fwrite(sizes, sizeof(sizes), 1, captureFile);
+    fwrite(capturePacked.data(), 1, capturePacked.size(), captureFile);
+}
+
+void CaptureWriterLoop() {
+    vector<unsigned char> writing;
+    while (true) {
+        {
+            unique_lock<mutex> lock(captureMutex);
+            captureWake.wait(lock, [] { return !captureQueued.empty() || !captureWriterRunning; });
+            if (captureQueued.empty()) break; // Stopped with nothing left to write
+            swap(writing, captureQueued);
+        }
+        WriteCaptureBlock(writing);
+        writing.clear(); // Keeps its capacity for the next swap
+    }
+}
+
+bool StartCapture(const string& path, int fps) {
+    captureFile = fopen(path.c_str(), "wb");
+    if (!captureFile) return false;
+    const Arena& arena = game.arena;
+    CaptureHeader header = { { 'N', 'W', 'C', 'P' }, CAPTURE_VERSION, (uint32_t)arena.width, (uint32_t)arena.height };
+    fwrite(&header, sizeof(header), 1, captureFile);
+    captureChars.Resize(arena.width, arena.height, 0);
+    captureColors.Resize(arena.width, arena.height, WHITE);
+    captureBlock.reserve(2 * CAPTURE_BLOCK_BYTES);
+    captureQueued.reserve(2 * CAPTURE_BLOCK_BYTES);
+    capturePacked.reserve(2 * CAPTURE_BLOCK_BYTES);
+    captureModel.reset(new ByteModel());
+    captureModel->Reset();
+    captureStart = steady_clock::now();
+    captureContentUs = fps > 0 ? 1000000 / fps : 0;
+    captureNeedsKey = true;
+    captureWriterRunning = true;
+    captureWriter = thread(CaptureWriterLoop);
+    capturing = true;
+    return true;
+}
+
+// Passes the block to the writer if it is free; a writer that cannot keep up
+// costs frames rather than game thread time or unbounded memory
+void HandOffCaptureBlock() {
+    bool handed = false;
+    {
+        lock_guard<mutex> lock(captureMutex);
+        if (captureQueued.empty()) {
+            swap(captureQueued, captureBlock);
+            handed = true;
+        }
+    }
+    if (handed) {
+        captureWake.notify_one();
+        captureBlockFrames = 0;
+    } else if (captureBlock.size() > CAPTURE_MAX_PENDING) {
+        captureFramesDropped += captureBlockFrames;
+        captureBlock.clear();
+        captureBlockFrames = 0;
+        captureNeedsKey = true; // The deltas it held are gone
+    }
+}
+
+// Codes the board into cell tokens against captureChars/captureColors and updates them
+void CodeCaptureCells(const FrameSnapshot& f) {
+    const char* chars = f.board.cells.data();
+    const unsigned char* colors = f.colors.cells.data();
+    char* shownChars = captureChars.cells.data();
+    unsigned char* shownColors = captureColors.cells.data();
+    const int n = (int)f.board.cells.size();
+    int skip = 0;
+    for (int i = 0; i < n; i++) {
+        if (chars[i] == shownChars[i] && colors[i] == shownColors[i]) {
+            skip++;
+            continue;
+        }
+        int run = 1;
+        while (i + run < n && chars[i + run] == chars[i] && colors[i + run] == colors[i]) run++;
+        if (skip > 0) PutVarint(captureBlock, (unsigned long long)skip << 1);
+        PutVarint(captureBlock, (unsigned long long)run << 1 | 1);
+        captureBlock.push_back((unsigned char)chars[i]);
+        captureBlock.push_back(colors[i]);
+        memset(shownChars + i, chars[i], run);
+        memset(shownColors + i, colors[i], run);
+        i += run - 1;
+        skip = 0;
+    }
+    captureBlock.push_back(0);
+}
+
+// HUD fields that changed since the last stored board (all of them on keyframes)
+void CodeCaptureHud(const FrameSnapshot& f, bool key) {
+    const int values[] = { f.score, f.highScore, f.playerHP, f.bossHP };
+    const int shown[] = { captureHud.score, captureHud.highScore, captureHud.playerHP, captureHud.bossHP };
+    unsigned char mask = 0;
+    for (int k = 0; k < 4; k++)
+        if (key || values[k] != shown[k]) mask |= 1 << k;
+    if (key || f.difficulty != captureHud.difficulty) mask |= 1 << HUD_DIFFICULTY;
+    if (key || HudFlags(f) != HudFlags(captureHud)) mask |= 1 << HUD_FLAGS;
+    captureBlock.push_back(mask);
+    for (int k = 0; k < 4; k++)
+        if (mask & (1 << k)) PutVarint(captureBlock, ZigZag(values[k]));
+    if (mask & (1 << HUD_DIFFICULTY)) {
+        const unsigned char* raw = (const unsigned char*)&f.difficulty;
+        captureBlock.insert(captureBlock.end(), raw, raw + sizeof(float));
+    }
+    if (mask & (1 << HUD_FLAGS)) captureBlock.push_back(HudFlags(f));
+    captureHud.score = f.score; captureHud.highScore = f.highScore;
+    captureHud.playerHP = f.playerHP; captureHud.bossHP = f.bossHP;
+    captureHud.difficulty = f.difficulty;
+    captureHud.hasBomb = f.hasBomb; captureHud.bossActive = f.bossActive; captureHud.paused = f.paused;
+}
+
+// Game thread: appends one frame to the capture
+void CaptureFrame(const FrameSnapshot& f) {
+    auto now = steady_clock::now();
+    if (f.board.width != captureChars.width || f.board.height != captureChars.height) {
+        captureChars.Resize(f.board.width, f.board.height, 0);
+        captureColors.Resize(f.board.width, f.board.height, WHITE);
+        captureNeedsKey = true;
+    }
+    long long tick = game.frameCounter;
+    bool key = captureNeedsKey || now - captureLastKey >= microseconds(CAPTURE_KEYFRAME_US);
+    // A millisecond of slack keeps 120 Hz frames from missing a 30 fps slot
+    bool content = key || f.paused || now - captureLastContent >= microseconds(captureContentUs - 1000);
+    if (key) {
+        captureBlock.push_back('K');
+        PutVarint(captureBlock, duration_cast<microseconds>(now - captureStart).count());
+        PutVarint(captureBlock, tick);
+        // Lets playback check that the deltas rebuilt the board exactly
+        unsigned long long shown = 0;
+        if (!captureNeedsKey) shown = HashBytes(HashBytes(FNV_OFFSET, captureChars.cells.data(), captureChars.cells.size()),
+                                                captureColors.cells.data(), captureColors.cells.size());
+        const unsigned char* raw = (const unsigned char*)&shown;
+        captureBlock.insert(captureBlock.end(), raw, raw + sizeof(shown));
+        captureChars.Fill(0);
+        captureLastKey = now;
+        captureNeedsKey = false;
+    } else {
+        captureBlock.push_back(content ? 'D' : 'T');
+        PutVarint(captureBlock, duration_cast<microseconds>(now - captureLastFrame).count());
+        PutVarint(captureBlock, max(0LL, tick - captureLastTick));
+    }
+    if (content) {
+        CodeCaptureHud(f, key);
+        CodeCaptureCells(f);
+        captureLastContent = now;
+    }
+    captureLastFrame = now;
+    captureLastTick = tick;
+    captureFrames++;
+    captureBlockFrames++;
+    if (captureBlock.size() >= CAPTURE_BLOCK_BYTES) HandOffCaptureBlock();
+}
+
+// Writes out everything still buffered and closes the file
+void StopCapture() {
+    if (!capturing) return;
+    capturing = false;
+    {
+        lock_guard<mutex> lock(captureMutex);
+        captureWriterRunning = false;
+    }
+    captureWake.notify_one();
+    captureWriter.join();
+    if (!captureBlock.empty()) WriteCaptureBlock(captureBlock);
+    captureBlock.clear();
+    fclose(captureFile);
+    captureFile = NULL;
+    if (captureFramesDropped > 0)
+        cerr << "Capture: " << captureFramesDropped << " frames dropped (writer fell behind)" << endl;
+}
+
+// ==========================================
+// 12. DRAWING
+// ==========================================
+
+// Sprite atlas: every sprite is a compile-time list of (offset, glyph, color)
+// cells relative to the entity position, so blitting writes the glyph and its
+// color together and nothing has to be re-classified after compositing.
+
+struct SpriteCell {
+    signed char dx, dy;
+    char glyph;
+    unsigned char color;
+};
+
+struct Sprite {
+    const SpriteCell* cells;
+    int count;
+};
+
+template <int N>
+constexpr Sprite MakeSprite(const SpriteCell (&cells)[N]) {
+    return { cells, N };
+}
+
+constexpr SpriteCell PLAYER_CELLS[] = {
+    { 0, 0, '}', GREEN }, { 1, 0, '=', WHITE }, { 2, 0, '=', WHITE }, { 3, 0, '^', GREEN },
+    { 4, 0, '=', WHITE }, { 5, 0, '=', WHITE }, { 6, 0, '>', GREEN },
+    { 2, -1, '\\', GREEN }, { 2, 1, '/', GREEN },
+};
+
+constexpr SpriteCell ENEMY_CELLS[] = {
+    { 0, 0, '<', RED }, { 1, 0, '=', WHITE }, { 2, 0, '=', WHITE }, { 3, 0, '^', RED },
+    { 4, 0, '=', WHITE }, { 5, 0, '=', WHITE }, { 6, 0, '{', RED },
+    { 3, -1, '/', RED }, { 3, 1, '\\', RED },
+};
+
+constexpr SpriteCell BOSS_CELLS[] = {
+    { 0, 0, '[', MAGENTA }, { 1, 0, '[', MAGENTA }, { 2, 0, '[', MAGENTA }, { 3, 0, '-', MAGENTA },
+    { 4, 0, '-', MAGENTA }, { 5, 0, 'M', MAGENTA }, { 6, 0, 'O', MAGENTA }, { 7, 0, 'N', MAGENTA },
+    { 8, 0, 'S', MAGENTA }, { 9, 0, 'T', MAGENTA }, { 10, 0, 'E', MAGENTA }, { 11, 0, 'R', MAGENTA },
+    { 12, 0, '-', MAGENTA }, { 13, 0, '-', MAGENTA }, { 14, 0, ']', MAGENTA }, { 15, 0, ']', MAGENTA },
+    { 16, 0, ']', MAGENTA },
+    { 5, -1, '/', MAGENTA }, { 5, 1, '\\', MAGENTA },
+};
+
+constexpr SpriteCell WINGMAN_CELLS[] = {
+    { 0, 0, '}', CYAN }, { 1, 0, '=', WHITE }, { 2, 0, '=', WHITE }, { 3, 0, '^', CYAN },
+    { 4, 0, '=', WHITE }, { 5, 0, '=', WHITE }, { 6, 0, '>', CYAN },
+    { 2, -1, '\\', CYAN }, { 2, 1, '/', CYAN },
+};
+
+constexpr SpriteCell PLAYER_BULLET_CELLS[] = { { 0, 0, '*', YELLOW } };
+constexpr SpriteCell ENEMY_BULLET_CELLS[] = { { 0, 0, 'o', WHITE } };
+constexpr SpriteCell BOOST_CELLS[] = { { 0, 0, 3, RED } }; // Heart glyph
+
+constexpr Sprite SPRITE_PLAYER = MakeSprite(PLAYER_CELLS);
+constexpr Sprite SPRITE_WINGMAN = MakeSprite(WINGMAN_CELLS);
+constexpr Sprite SPRITE_ENEMY = MakeSprite(ENEMY_CELLS);
+constexpr Sprite SPRITE_BOSS = MakeSprite(BOSS_CELLS);
+constexpr Sprite SPRITE_PLAYER_BULLET = MakeSprite(PLAYER_BULLET_CELLS);
+constexpr Sprite SPRITE_ENEMY_BULLET = MakeSprite(ENEMY_BULLET_CELLS);
+constexpr Sprite SPRITE_BOOST = MakeSprite(BOOST_CELLS);
+
+void BlitSprite(FrameSnapshot& f, const Sprite& sprite, int x, int y) {
+    for (int i = 0; i < sprite.count; i++) {
+        const SpriteCell& cell = sprite.cells[i];
+        int cx = x + cell.dx, cy = y + cell.dy;
+        if (cx < 0 || cx >= f.board.width || cy < 0 || cy >= f.board.height) continue;
+        f.board[cy][cx] = cell.glyph;
+        f.colors[cy][cx] = cell.color;
+    }
+}
+
+// Background stars are generated once and scrolled; the layer is two board
+// widths wide (the second half repeats the first) so any offset below the
+// board width is a single contiguous copy per row.
+const int STAR_SCROLL_TICKS = 6; // Ticks per column of scroll
+Plane<char> starfield;
+
+void BuildStarfield(int width, int height) {
+    starfield.Resize(width * 2, height, ' ');
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            starfield[y][x] = rngVisual.Range(200) == 0 ? '.' : ' ';
+            starfield[y][x + width] = starfield[y][x];
+        }
+    }
+    starfieldReady = true;
+}
+
+// Simulation side of a frame: composites the board and copies the HUD values
+// out of the game state, so nothing the renderer reads is shared with Logic()
+void ComposeFrame(FrameSnapshot& f) {
+    // Clear board and add stars
+    const int width = f.board.width, height = f.board.height;
+    if (!starfieldReady) BuildStarfield(width, height);
+    int starOffset = (game.frameCounter / STAR_SCROLL_TICKS) % width;
+    for (int y = 0; y < height; y++) memcpy(f.board[y], starfield[y] + starOffset, width);
+    f.colors.Fill(WHITE);
+
+    // Draw player
+    BlitSprite(f, SPRITE_PLAYER, game.playerX, game.playerY);
+    if (game.twoPlayers) BlitSprite(f, SPRITE_WINGMAN, game.wingX, game.wingY);
+
+    // Draw enemies
+    for (int k = 0; k < game.enemies.size(); k++)
+        BlitSprite(f, game.enemies[k].type == 1 ? SPRITE_BOSS : SPRITE_ENEMY, game.enemies[k].x, game.enemies[k].y);
+
+    // Draw bullets (not the ones on their way out, culled next tick)
+    const BulletStream& pb = game.playerBullets;
+    const BulletStream& eb = game.enemyBullets;
+    for (int k = 0; k < pb.size(); k++)
+        if (BulletInArena(pb.x[k], pb.y[k], game.arena)) BlitSprite(f, SPRITE_PLAYER_BULLET, (int)pb.x[k], (int)pb.y[k]);
+    for (int k = 0; k < eb.size(); k++)
+        if (BulletInArena(eb.x[k], eb.y[k], game.arena)) BlitSprite(f, SPRITE_ENEMY_BULLET, (int)eb.x[k], (int)eb.y[k]);
+    
+    // Draw power-up
+    if (game.boostPack.active && game.boostPack.x > 0 && game.boostPack.x < width) 
+        BlitSprite(f, SPRITE_BOOST, game.boostPack.x, game.boostPack.y);
+
+    f.score = game.score;
+    f.highScore = highScore;
+    f.playerHP = game.playerHP;
+    f.bossHP = game.bossHP;
+    f.difficulty = game.difficultyMultiplier;
+    f.hasBomb = game.hasBomb;
+    f.bossActive = game.bossActive;
+    f.paused = game.isPaused;
+    f.profileText[0] = 0;
+    if (profilerOverlay) FormatProfilerOverlay(f.profileText, sizeof(f.profileText));
+}
+
+// Console side of a frame: border, board and HUD into the back planes, then
+// out to the terminal. Reads nothing but the snapshot.
+void RenderFrame(const FrameSnapshot& f) {
+    const int width = f.board.width, height = f.board.height;
+
+    // Compose board and border into the back planes
+    for (int x = 0; x < width + 2; x++) {
+        backChars[0][x] = (char)178; backColors[0][x] = CYAN;
+        backChars[height + 1][x] = (char)178; backColors[height + 1][x] = CYAN;
+    }
+    for (int y = 0; y < height; y++) {
+        backChars[y + 1][0] = (char)178; backColors[y + 1][0] = CYAN;
+        memcpy(&backChars[y + 1][1], f.board[y], width);
+        memcpy(&backColors[y + 1][1], f.colors[y], width);
+        backChars[y + 1][width + 1] = (char)178; backColors[y + 1][width + 1] = CYAN;
+    }
+    if (f.paused) PutText(width / 2 - 5, height / 2, "*** PAUSED ***", RED);
+    
+    // HUD line
+    int hy = height + 2;
+    char text[32];
+    for (int x = 0; x < SCREEN_WIDTH; x++) { backChars[hy][x] = ' '; backColors[hy][x] = WHITE; }
+    
+    // Score Display
+    snprintf(text, sizeof(text), " SCORE: %d ", f.score);
+    int hx = PutText(0, hy, text, YELLOW);
+    
+    // High Score Display
+    snprintf(text, sizeof(text), "| HIGH: %d ", f.highScore);
+    hx = PutText(hx, hy, text, MAGENTA);
+    
+    // Difficulty Display
+    snprintf(text, sizeof(text), "| SPEED: x%.1f ", f.difficulty);
+    hx = PutText(hx, hy, text, CYAN);
+    
+    // Health Bar with Percentage
+    hx = PutText(hx, hy, "| HP: ", WHITE);
+    int hpColor = f.playerHP > 50 ? GREEN : (f.playerHP > 30 ? YELLOW : RED);
+    hx = PutBar(hx, hy, f.playerHP / 10, hpColor);
+    snprintf(text, sizeof(text), "] %d%%  ", f.playerHP);
+    hx = PutText(hx, hy, text, hpColor);
+    
+    // Bomb Status
+    hx = PutText(hx, hy, f.hasBomb ? "| BOMB: READY " : "| BOMB: ---- ", CYAN);
+    
+    // Boss Status
+    hx = PutText(hx, hy, "| BOSS: ", MAGENTA);
+    if (f.bossActive) {
+        hx = PutBar(hx, hy, f.bossHP / 10, MAGENTA);
+        PutText(hx, hy, "]", MAGENTA);
+    } else {
+        PutText(hx, hy, "----", MAGENTA);
+    }
+    
+    if (f.profileText[0]) DrawProfilerOverlay(f.profileText);
+    
+    PresentFrame();
+}
+
+// Draws the current state on the calling thread (paused screen, stress runs)
+void Draw() {
+    ComposeFrame(drawFrame);
+    if (capturing) CaptureFrame(drawFrame);
+    RenderFrame(drawFrame);
+}
+
+// During play a render thread owns console output and always draws the newest
+// published snapshot, so a slow terminal never holds up a tick or the input
+// sampling; frames it cannot keep up with are skipped. The mutex and condition
+// variable are only for sleeping while there is nothing new to draw.
+thread renderThread;
+atomic<bool> renderRunning(false);
+mutex renderMutex;
+condition_variable renderWake;
+long long framesPublished = 0, framesSuperseded = 0; // Game loop side
+atomic<long long> framesRendered(0);
+
+void RenderLoop() {
+    while (true) {
+        {
+            unique_lock<mutex> lock(renderMutex);
+            renderWake.wait(lock, [] { return frameBuffer.fresh() || !renderRunning; });
+        }
+        if (frameBuffer.acquire()) {
+            RenderFrame(frameBuffer.frontSlot());
+            framesRendered++;
+        } else if (!renderRunning) {
+            break; // Stopped with nothing left to draw
+        }
+    }
+}
+
+void WakeRenderer() {
+    { lock_guard<mutex> lock(renderMutex); }
+    renderWake.notify_one();
+}
+
+void StartRenderThread() {
+    renderRunning = true;
+    renderThread = thread(RenderLoop);
+}
+
+// Returns once the last published frame is on screen
+void StopRenderThread() {
+    {
+        lock_guard<mutex> lock(renderMutex);
+        renderRunning = false;
+    }
+    renderWake.notify_one();
+    renderThread.join();
+}
+
+// Game loop side: composes into the free slot and hands it to the renderer
+void PublishFrame() {
+    ComposeFrame(frameBuffer.backSlot());
+    if (capturing) CaptureFrame(frameBuffer.backSlot());
+    if (frameBuffer.publish()) framesSuperseded++;
+    framesPublished++;
+    WakeRenderer();
+}
+
+// ==========================================
+// 13. INPUT RECORDING & REPLAY
+// ==========================================
+
+// A recording is the seed plus the key bitmask of every tick, stored as
+// (keys, run length) pairs, followed at the end by nothing else: the header
+// carries the tick count and the state hash after the last tick, which a
+// replay must reproduce exactly.
+//
+// File layout: ReplayHeader, then per run one key byte and a LEB128 tick count.
+
+struct ReplayHeader {
+    char magic[4];          // "NWRP"
+    uint32_t version;
+    uint32_t seed;
+    uint32_t ticks;
+    uint64_t finalHash;
+};
+
+struct KeyRun {
+    unsigned char keys;
+    uint32_t ticks;
+};
+
+const uint32_t REPLAY_VERSION = 6; // 2: per-subsystem PCG streams instead of rand(), 3: timer wheel, 4: swept collision, 5: bullet patterns,
+                                   // 6: boss timers armed on the wheel clock, bullets culled at their start-of-tick position
+
+bool recording = false;
+bool replaying = false;
+vector<KeyRun> recordRuns;
+uint32_t recordTicks = 0;
+ReplayHeader replayHeader;
+vector<KeyRun> replayRuns;
+size_t replayRun = 0;
+uint32_t replayRunUsed = 0, replayTicks = 0;
+
+unsigned long long GameState::StateHash() const {
+    unsigned long long h = FNV_OFFSET;
+    h = HashValue(h, playerX); h = HashValue(h, playerY);
+    h = HashValue(h, playerHP); h = HashValue(h, score);
+    h = HashValue(h, enemiesKilledForBoost); h = HashValue(h, triShotAmmo);
+    h = HashValue(h, hasBomb); h = HashValue(h, isPaused);
+    h = HashValue(h, bossHP); h = HashValue(h, maxBossHP); h = HashValue(h, bossActive);
+    h = HashValue(h, frameCounter); h = HashValue(h, difficultyMultiplier);
+    h = HashValue(h, lastScoreMilestone);
+    h = HashValue(h, pauseKeyHeld); h = HashValue(h, bombKeyHeld); h = HashValue(h, fireCooldown);
+    h = HashValue(h, rngSpawn.state); h = HashValue(h, rngAI.state);
+    for (const Object& e : enemies) {
+        h = HashValue(h, e.x); h = HashValue(h, e.y);
+        h = HashValue(h, e.hp); h = HashValue(h, e.type); h = HashValue(h, e.volley);
+    }
+    for (const BulletStream* s : { &playerBullets, &enemyBullets }) {
+        h = HashValue(h, s->count);
+        h = HashBytes(h, s->x.data(), s->count * sizeof(float));
+        h = HashBytes(h, s->y.data(), s->count * sizeof(float));
+        h = HashBytes(h, s->dx.data(), s->count * sizeof(float));
+        h = HashBytes(h, s->dy.data(), s->count * sizeof(float));
+    }
+    h = HashValue(h, boostPack.active);
+    if (boostPack.active) { h = HashValue(h, boostPack.x); h = HashValue(h, boostPack.y); }
+    if (twoPlayers) { // One-player hashes stay as they were
+        h = HashValue(h, wingX); h = HashValue(h, wingY); h = HashValue(h, wingFireCooldown);
+    }
+    return h;
+}
+
+void StartRecording() {
+    recording = true;
+    recordRuns.clear();
+    recordRuns.reserve(4096); // A run per key change; this covers a long game without reallocating
+    recordTicks = 0;
+}
+
+void RecordKeys(unsigned char keys) {
+    if (!recordRuns.empty() && recordRuns.back().keys == keys) recordRuns.back().ticks++;
+    else recordRuns.push_back({ keys, 1 });
+    recordTicks++;
+}
+
+bool SaveRecording(const string& path, unsigned int seed) {
+    FILE* file = fopen(path.c_str(), "wb");
+    if (!file) return false;
+    ReplayHeader header = { { 'N', 'W', 'R', 'P' }, REPLAY_VERSION, seed, recordTicks, game.StateHash() };
+    fwrite(&header, sizeof(header), 1, file);
+    for (const KeyRun& run : recordRuns) {
+        fputc(run.keys, file);
+        uint32_t n = run.ticks;
+        do {
+            fputc((n & 0x7F) | (n > 0x7F ? 0x80 : 0), file);
+            n >>= 7;
+        } while (n);
+    }
+    bool ok = !ferror(file);
+    fclose(file);
+    return ok;
+}
+
+bool LoadRecording(const string& path) {
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file) return false;
+    bool ok = fread(&replayHeader, sizeof(replayHeader), 1, file) == 1 &&
+              memcmp(replayHeader.magic, "NWRP", 4) == 0 && replayHeader.version == REPLAY_VERSION;
+    replayRuns.clear();
+    uint32_t total = 0;
+    int keys;
+    while (ok && (keys = fgetc(file)) != EOF) {
+        uint32_t n = 0;
+        int shift = 0, c;
+        do {
+            c = fgetc(file);
+            if (c == EOF || shift > 28) { ok = false; break; }
+            n |= (uint32_t)(c & 0x7F) << shift;
+            shift += 7;
+        } while (c & 0x80);
+        replayRuns.push_back({ (unsigned char)keys, n });
+        total += n;
+    }
+    fclose(file);
+    replayRun = 0; replayRunUsed = 0; replayTicks = 0;
+    return ok && total == replayHeader.ticks;
+}
+
+bool ReplayFinished() {
+    return replayRun >= replayRuns.size();
+}
+
+unsigned char NextReplayKeys() {
+    if (ReplayFinished()) return 0;
+    unsigned char keys = replayRuns[replayRun].keys;
+    if (++replayRunUsed >= replayRuns[replayRun].ticks) { replayRun++; replayRunUsed = 0; }
+    replayTicks++;
+    return keys;
+}
+
+// Key state for the next tick: from the replay or the keyboard, logged when recording
+unsigned char ReadInput() {
+    unsigned char keys = replaying ? NextReplayKeys() : SampleKeyboard();
+    if (recording) RecordKeys(keys);
+    return keys;
+}
+
+bool ReplayMatches() {
+    return replayTicks == replayHeader.ticks && game.StateHash() == replayHeader.finalHash;
+}
+
+// ==========================================
+// 14. QUICKSAVE
+// ==========================================
+
+// A snapshot is the whole simulation state of one game, so a run can be
+// quit and picked up later at exactly the same tick. Netplay keeps the same
+// encoding (without the header) for every recent tick to roll back to. Everything is plain
+// data (the timer wheel stores event kinds, not callbacks) and is copied
+// field by field; the broadphase grid is rebuilt every tick and not saved.
+// Pausing or quitting with ESC saves the run to QUICKSAVE_FILE, the menu
+// offers to resume it, and it is deleted once that run ends.
+//
+// File layout: SnapshotHeader, then the fields in VisitSnapshot order.
+
+struct SnapshotHeader {
+    char magic[4];     // "NWSV"
+    uint32_t version;
+    uint32_t size;     // Bytes after the header
+    uint32_t reserved;
+    uint64_t checksum; // SnapshotChecksum()
+    uint64_t patterns; // PatternTableHash() of the run; other patterns would play it differently
+    Arena arena;       // Always the default one: only interactive runs are saved
+};
+
+const uint32_t SNAPSHOT_VERSION = 3; // 2: second ship, 3: checksum covers the arena
+
+// FNV-1a of the header fields after the checksum and of the body; the arena
+// sizes the pools, so a damaged one must not get as far as Configure()
+uint64_t SnapshotChecksum(const char* data, size_t size) {
+    size_t from = offsetof(SnapshotHeader, patterns), to = offsetof(SnapshotHeader, arena) + sizeof(Arena);
+    uint64_t h = HashBytes(FNV_OFFSET, data + from, to - from);
+    return HashBytes(h, data + sizeof(SnapshotHeader), size - sizeof(SnapshotHeader));
+}
+
+vector<char> snapshotBuffer; // Encoded snapshot, reused between saves
+bool quicksaveOwned = false; // The current run saved or resumed the quicksave
+int quicksaveTick = -1;      // game.frameCounter the owned quicksave holds
+
+unsigned long long PatternTableHash() {
+    unsigned long long h = FNV_OFFSET;
+    for (const BulletPattern& p : bulletPatterns) {
+        h = HashValue(h, p.hp); h = HashValue(h, p.shots); h = HashValue(h, p.steps);
+        h = HashValue(h, p.aimed); h = HashValue(h, p.first);
+    }
+    h = HashBytes(h, patternDx.data(), patternDx.size() * sizeof(float));
+    return HashBytes(h, patternDy.data(), patternDy.size() * sizeof(float));
+}
+
+// Calls io(field, bytes) for every piece of simulation state in file order.
+// Saving and loading walk the same list, so the two cannot drift apart; io
+// returns false to stop. Entity counts come before their entities and are
+// checked against the pools, which the arena in the header sized.
+template <typename G, typename F>
+bool VisitSnapshot(G& g, F io) {
+    auto field = [&](auto& value) { return io(&value, sizeof(value)); };
+    bool ok = field(g.playerX) && field(g.playerY) && field(g.playerHP) && field(g.score) &&
+              field(g.enemiesKilledForBoost) && field(g.triShotAmmo) && field(g.hasBomb) &&
+              field(g.bossHP) && field(g.maxBossHP) && field(g.bossActive) && field(g.bossesKilled) &&
+              field(g.gameRunning) && field(g.isPaused) && field(g.inputKeys) &&
+              field(g.pauseKeyHeld) && field(g.bombKeyHeld) && field(g.fireCooldown) &&
+              field(g.prevPlayerX) && field(g.prevPlayerY) && field(g.twoPlayers) &&
+              field(g.wingX) && field(g.wingY) && field(g.prevWingX) && field(g.prevWingY) &&
+              field(g.wingFireCooldown) && field(g.wingKeys) && field(g.sweptHits) &&
+              field(g.boostPack) && field(g.frameCounter) &&
+              field(g.difficultyMultiplier) && field(g.lastScoreMilestone) &&
+              field(g.timers) && field(g.spawnTimer) && field(g.nextEnemyId) &&
+              field(g.rngSpawn) && field(g.rngAI) && field(g.enemies.count);
+    if (!ok || g.enemies.count < 0 || g.enemies.count > g.enemies.capacity()) return false;
+    if (!io(g.enemies.begin(), sizeof(Object) * g.enemies.count)) return false;
+    for (auto* b : { &g.playerBullets, &g.enemyBullets }) {
+        if (!field(b->count) || b->count < 0 || b->count > b->capacity()) return false;
+        size_t bytes = sizeof(float) * b->count;
+        if (!io(b->x.data(), bytes) || !io(b->y.data(), bytes) || !io(b->dx.data(), bytes) || !io(b->dy.data(), bytes)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Appends the state of g to out; no allocation once out has grown to fit
+void EncodeState(const GameState& g, vector<char>& out) {
+    VisitSnapshot(g, [&](const void* data, size_t bytes) {
+        const char* p = (const char*)data;
+        out.insert(out.end(), p, p + bytes);
+        return true;
+    });
+}
+
+// Reads what EncodeState wrote back into g, which must have the same arena
+bool DecodeState(const char* data, size_t size, GameState& g) {
+    size_t offset = 0;
+    bool ok = VisitSnapshot(g, [&](void* field, size_t bytes) {
+        if (bytes > size - offset) return false;
+        memcpy(field, data + offset, bytes);
+        offset += bytes;
+        return true;
+    });
+    return ok && offset == size;
+}
+
+// Encodes g into snapshotBuffer (header included)
+void EncodeSnapshot(const GameState& g) {
+    snapshotBuffer.resize(sizeof(SnapshotHeader));
+    EncodeState(g, snapshotBuffer);
+    SnapshotHeader header = SnapshotHeader(); // Zeroed first, padding included
+    memcpy(header.magic, "NWSV", 4);
+    header.version = SNAPSHOT_VERSION;
+    header.size = (uint32_t)(snapshotBuffer.size() - sizeof(SnapshotHeader));
+    header.patterns = PatternTableHash();
+    header.arena = g.arena;
+    memcpy(snapshotBuffer.data(), &header, sizeof(header));
+    header.checksum = SnapshotChecksum(snapshotBuffer.data(), snapshotBuffer.size());
+    memcpy(snapshotBuffer.data() + offsetof(SnapshotHeader, checksum), &header.checksum, sizeof(header.checksum));
+}
+
+bool SaveSnapshot(const GameState& g, const string& path) {
+    EncodeSnapshot(g);
+    return WriteFileSafely(path, snapshotBuffer.data(), sizeof(SnapshotHeader),
+                           snapshotBuffer.data() + sizeof(SnapshotHeader), snapshotBuffer.size() - sizeof(SnapshotHeader));
+}
+
+// Reads a snapshot into data and checks it is complete and undamaged; the
+// simulation is not touched until RestoreSnapshot
+bool LoadSnapshot(const string& path, vector<char>& data, string& error) {
+    data.clear();
+    error.clear();
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file) {
+        error = "cannot read " + path;
+        return false;
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    if (size > 0) data.resize((size_t)size);
+    bool read = size > 0 && fread(data.data(), 1, data.size(), file) == data.size();
+    fclose(file);
+
+    SnapshotHeader header;
+    const Arena defaultArena;
+    if (!read || data.size() < sizeof(header)) error = "truncated";
+    if (error.empty()) {
+        memcpy(&header, data.data(), sizeof(header));
+        if (memcmp(header.magic, "NWSV", 4) != 0) error = "not a saved game";
+        else if (header.version != SNAPSHOT_VERSION) error = "saved by another version";
+        else if (header.size != data.size() - sizeof(header)) error = "truncated";
+        else if (header.checksum != SnapshotChecksum(data.data(), data.size())) error = "damaged";
+        else if (header.patterns != PatternTableHash()) error = "saved with other bullet patterns";
+        else if (memcmp(&header.arena, &defaultArena, sizeof(Arena)) != 0) error = "not a regular game";
+    }
+    if (!error.empty()) data.clear();
+    return error.empty();
+}
+
+// Puts a snapshot checked by LoadSnapshot into g. The body is decoded into a
+// scratch state first, so g is only touched once the whole snapshot fits.
+bool RestoreSnapshot(const vector<char>& data, GameState& g) {
+    SnapshotHeader header;
+    memcpy(&header, data.data(), sizeof(header));
+    const char* body = data.data() + sizeof(header);
+    size_t size = data.size() - sizeof(header);
+    unique_ptr<GameState> scratch(new GameState());
+    scratch->Configure(header.arena);
+    if (!DecodeState(body, size, *scratch)) return false;
+    if (memcmp(&header.arena, &g.arena, sizeof(Arena)) != 0) g.Configure(header.arena);
+    return DecodeState(body, size, g);
+}
+
+// The interactive quicksave; on failure the run just is not saved. A paused
+// game does not tick, so pausing again at the same tick keeps the file as is.
+bool SaveQuicksave() {
+    if (quicksaveOwned && quicksaveTick == game.frameCounter) return true;
+    if (!SaveSnapshot(game, QUICKSAVE_FILE)) return false;
+    quicksaveOwned = true;
+    quicksaveTick = game.frameCounter;
+    return true;
+}
+
+// The run that owned the quicksave is over
+void DropQuicksave() {
+    if (!quicksaveOwned) return;
+    remove(QUICKSAVE_FILE.c_str());
+    quicksave.clear();
+    quicksaveOwned = false;
+}
+
+// ==========================================
+// 15. NETPLAY
+// ==========================================
+
+// Two players share one game over UDP. Each side simulates every tick
+// straight away with its own keys and a prediction of the other side's (the
+// last keys that arrived). When the real keys for an earlier tick turn out to
+// be different, it restores the state encoded at the start of that tick and
+// runs the ticks since again. Only when the other side falls more than
+// NET_MAX_PREDICTION ticks behind does this side stall.
+//
+// Every packet carries all of the sender's keys the receiver has not yet
+// acknowledged, so a lost packet costs nothing but a longer prediction. The
+// host flies the first ship and picks the seed; the joiner flies the second.
+// Both sides also send the state hash of a confirmed tick every
+// NET_CHECK_TICKS, so a desync is reported instead of played on.
+
+const int NET_MAX_PREDICTION = 12; // Ticks run ahead of the remote keys (100 ms)
+const int NET_STATES = 16;         // Saved states, more than NET_MAX_PREDICTION; a power of two
+const int NET_INPUTS = 128;        // Key history per ship; a power of two
+const int NET_KEYS_PER_PACKET = 64;
+const int NET_CHECK_TICKS = 60;
+const int NET_CHECKS = 8;          // Own recent check hashes kept to compare
+const int NET_TIMEOUT_MS = 5000;   // Silence after which the other side is gone
+const int NET_DELAYED = 256;       // Packets held back for injected latency
+const unsigned char NET_KEY_MASK = (unsigned char)~KEY_PAUSE; // A shared game cannot pause
+
+enum NetPacketType {
+    NET_HELLO,   // Joiner -> host until welcomed
+    NET_WELCOME, // Host -> joiner, with the seed
+    NET_KEYS,
+};
+
+struct NetPacket {
+    char magic[4];     // "NWNP"
+    uint8_t type;
+    uint8_t count;     // NET_KEYS: keys carried
+    uint16_t reserved;
+    uint32_t seed;     // NET_WELCOME: the game's seed
+    int32_t first;     // NET_KEYS: tick of keys[0]
+    int32_t ack;       // Last tick of the receiver's keys the sender has
+    int32_t checkTick; // A confirmed tick and the state hash at its start; -1 before the first
+    uint64_t checkHash;
+    uint8_t keys[NET_KEYS_PER_PACKET];
+};
+
+const int NET_HEADER_SIZE = (int)offsetof(NetPacket, keys);
+
+#ifdef _WIN32
+typedef SOCKET NetSocket;
+const NetSocket NO_SOCKET = INVALID_SOCKET;
+#else
+typedef int NetSocket;
+const NetSocket NO_SOCKET = -1;
+#endif
+
+void CloseUdpSocket(NetSocket s) {
+#ifdef _WIN32
+    closesocket(s);
+#else
+    close(s);
+#endif
+}
+
+// Non-blocking UDP socket bound to port on every interface (0: any free port)
+NetSocket OpenUdpSocket(int port) {
+#ifdef _WIN32
+    static bool started = false;
+    WSADATA wsa;
+    if (!started && WSAStartup(MAKEWORD(2, 2), &wsa) != 0) return NO_SOCKET;
+    started = true;
+#endif
+    NetSocket s = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (s == NO_SOCKET) return NO_SOCKET;
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons((uint16_t)port);
+    bool ok = bind(s, (sockaddr*)&addr, sizeof(addr)) == 0;
+#ifdef _WIN32
+    u_long nonBlocking = 1;
+    ok = ok && ioctlsocket(s, FIONBIO, &nonBlocking) == 0;
+#else
+    ok = ok && fcntl(s, F_SETFL, fcntl(s, F_GETFL) | O_NONBLOCK) == 0;
+#endif
+    if (!ok) {
+        CloseUdpSocket(s);
+        return NO_SOCKET;
+    }
+    return s;
+}
+
+int BoundPort(NetSocket s) {
+    sockaddr_in addr;
+    socklen_t size = sizeof(addr);
+    if (getsockname(s, (sockaddr*)&addr, &size) != 0) return 0;
+    return ntohs(addr.sin_port);
+}
+
+// "host:port", IPv4 only
+bool ResolveAddress(const string& hostPort, sockaddr_in& addr) {
+    size_t colon = hostPort.rfind(':');
+    if (colon == string::npos) return false;
+    string host = hostPort.substr(0, colon), port = hostPort.substr(colon + 1);
+    addrinfo hints, *found = NULL;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+    if (getaddrinfo(host.c_str(), port.c_str(), &hints, &found) != 0 || !found) return false;
+    memcpy(&addr, found->ai_addr, sizeof(addr));
+    freeaddrinfo(found);
+    return true;
+}
+
+struct DelayedPacket {
+    steady_clock::time_point due;
+    int size;
+    NetPacket packet;
+};
+
+struct NetPeer {
+    NetSocket sock = NO_SOCKET;
+    sockaddr_in remote;
+    bool connected = false;
+    int player = 0; // Ship flown from this side: 0 on the host, 1 on the joiner
+    uint32_t seed = 0;
+    steady_clock::time_point lastHeard;
+
+    unsigned char keys[2][NET_INPUTS];   // Per ship, by tick & (NET_INPUTS - 1)
+    unsigned char predicted[NET_INPUTS]; // Remote keys each tick was last simulated with
+    vector<char> states[NET_STATES];     // EncodeState() at the start of each recent tick
+    int tick = 0;          // Next tick to simulate
+    int remoteTick = -1;   // Remote keys are known up to and including this tick
+    int remoteAck = -1;    // The other side has our keys up to this tick
+    int rollbackFrom = -1; // Earliest tick simulated with a wrong prediction
+    int checkTicks[NET_CHECKS];
+    unsigned long long checkHashes[NET_CHECKS];
+    int latestCheck = -1, comparedCheck = -1;
+    bool endless = false;  // Start a new game when one ends (loopback test)
+    bool finished = false; // Game over at a tick both sides' keys confirm, or the other side is gone
+    bool lost = false;
+
+    // Injected network conditions, applied to outgoing packets
+    int latencyMs = 0, lossPercent = 0;
+    Rng rngLoss;
+    DelayedPacket delayed[NET_DELAYED];
+    int delayedHead = 0, delayedCount = 0;
+
+    long long sent = 0, dropped = 0, received = 0;
+    long long rollbacks = 0, resimulated = 0, stalls = 0, checks = 0, desyncs = 0;
+    int maxRollback = 0;
+    double rollbackUsTotal = 0, rollbackUsMax = 0;
+};
+
+NetPeer net;
+bool netplay = false; // Interactive game against net
+
+// Sends now, later or never, as the injected conditions say
+void NetSendPacket(NetPeer& n, const NetPacket& p, int size) {
+    if (n.lossPercent > 0 && n.rngLoss.Range(100) < n.lossPercent) {
+        n.dropped++;
+        return;
+    }
+    n.sent++;
+    if (n.latencyMs <= 0) {
+        sendto(n.sock, (const char*)&p, size, 0, (const sockaddr*)&n.remote, sizeof(n.remote));
+        return;
+    }
+    if (n.delayedCount == NET_DELAYED) { // Queue full: the link is that congested
+        n.dropped++;
+        return;
+    }
+    DelayedPacket& d = n.delayed[(n.delayedHead + n.delayedCount++) % NET_DELAYED];
+    d.due = steady_clock::now() + milliseconds(n.latencyMs);
+    d.size = size;
+    memcpy(&d.packet, &p, size);
+}
+
+// Constant latency, so the queue is in due order
+void NetFlushDelayed(NetPeer& n) {
+    auto now = steady_clock::now();
+    while (n.delayedCount > 0 && n.delayed[n.delayedHead].due <= now) {
+        const DelayedPacket& d = n.delayed[n.delayedHead];
+        sendto(n.sock, (const char*)&d.packet, d.size, 0, (const sockaddr*)&n.remote, sizeof(n.remote));
+        n.delayedHead = (n.delayedHead + 1) % NET_DELAYED;
+        n.delayedCount--;
+    }
+}
+
+NetPacket NetHeader(const NetPeer& n, int type) {
+    NetPacket p;
+    memcpy(p.magic, "NWNP", 4);
+    p.type = (uint8_t)type;
+    p.count = 0;
+    p.reserved = 0;
+    p.seed = n.seed;
+    p.first = 0;
+    p.ack = n.remoteTick;
+    p.checkTick = n.latestCheck;
+    p.checkHash = n.latestCheck >= 0 ? n.checkHashes[(n.latestCheck / NET_CHECK_TICKS) % NET_CHECKS] : 0;
+    return p;
+}
+
+// Our keys the other side has not acknowledged, oldest first. Sent every
+// tick even when empty: it also carries the ack and keeps the link alive.
+void NetSendKeys(NetPeer& n) {
+    NetPacket p = NetHeader(n, NET_KEYS);
+    p.first = n.remoteAck + 1;
+    p.count = (uint8_t)max(0, min(n.tick - p.first, NET_KEYS_PER_PACKET));
+    for (int i = 0; i < p.count; i++) p.keys[i] = n.keys[n.player][(p.first + i) & (NET_INPUTS - 1)];
+    NetSendPacket(n, p, NET_HEADER_SIZE + p.count);
+}
+
+void NetRecordCheck(NetPeer& n, int tick, unsigned long long hash) {
+    int slot = (tick / NET_CHECK_TICKS) % NET_CHECKS;
+    n.checkTicks[slot] = tick;
+    n.checkHashes[slot] = hash;
+    n.latestCheck = max(n.latestCheck, tick);
+}
+
+// Hashes the saved state of the newest check tick that every key before it
+// is known for; both sides get the same bytes from it unless they diverged
+void NetRecordChecks(NetPeer& n) {
+    int confirmed = min(n.remoteTick + 1, n.tick - 1); // The newest saved state is tick - 1
+    if (confirmed < 0 || n.rollbackFrom >= 0) return;
+    int t = confirmed - confirmed % NET_CHECK_TICKS;
+    if (t <= n.latestCheck || n.tick - t > NET_STATES) return;
+    const vector<char>& state = n.states[t & (NET_STATES - 1)];
+    NetRecordCheck(n, t, HashBytes(FNV_OFFSET, state.data(), state.size()));
+}
+
+void NetCompareCheck(NetPeer& n, int tick, unsigned long long hash) {
+    if (tick <= n.comparedCheck) return;
+    int slot = (tick / NET_CHECK_TICKS) % NET_CHECKS;
+    if (n.checkTicks[slot] != tick) return; // Not confirmed here yet, or long gone
+    n.comparedCheck = tick;
+    n.checks++;
+    if (n.checkHashes[slot] != hash) n.desyncs++;
+}
+
+void NetHandleKeys(NetPeer& n, const NetPacket& p) {
+    n.remoteAck = max(n.remoteAck, p.ack);
+    int other = 1 - n.player;
+    for (int i = 0; i < p.count; i++) {
+        int t = p.first + i;
+        if (t != n.remoteTick + 1) continue; // Already have it
+        unsigned char k = p.keys[i] & NET_KEY_MASK;
+        n.keys[other][t & (NET_INPUTS - 1)] = k;
+        if (t < n.tick && n.predicted[t & (NET_INPUTS - 1)] != k && (n.rollbackFrom < 0 || t < n.rollbackFrom)) {
+            n.rollbackFrom = t;
+        }
+        n.remoteTick = t;
+    }
+    if (p.checkTick >= 0) NetCompareCheck(n, p.checkTick, p.checkHash);
+}
+
+void NetReceive(NetPeer& n) {
+    NetPacket p;
+    sockaddr_in from;
+    while (true) {
+        socklen_t fromSize = sizeof(from);
+        int size = (int)recvfrom(n.sock, (char*)&p, sizeof(p), 0, (sockaddr*)&from, &fromSize);
+        if (size < 0) break; // Nothing more (or an ICMP error from a closed port)
+        if (size < NET_HEADER_SIZE || memcmp(p.magic, "NWNP", 4) != 0 || size < NET_HEADER_SIZE + p.count) continue;
+        bool fromRemote = n.connected && from.sin_addr.s_addr == n.remote.sin_addr.s_addr &&
+                          from.sin_port == n.remote.sin_port;
+        // Returns as soon as it connects: keys queued behind wait for NetStart()
+        if (p.type == NET_HELLO && n.player == 0 && (!n.connected || fromRemote)) {
+            bool first = !n.connected;
+            n.remote = from;
+            n.connected = true;
+            n.lastHeard = steady_clock::now();
+            NetPacket welcome = NetHeader(n, NET_WELCOME);
+            NetSendPacket(n, welcome, NET_HEADER_SIZE);
+            if (first) return;
+        } else if (p.type == NET_WELCOME && n.player == 1 && !n.connected) {
+            n.seed = p.seed;
+            n.connected = true;
+            n.lastHeard = steady_clock::now();
+            return;
+        } else if (p.type == NET_KEYS && fromRemote) {
+            n.received++;
+            n.lastHeard = steady_clock::now();
+            if (p.count <= NET_KEYS_PER_PACKET) NetHandleKeys(n, p);
+        }
+    }
+}
+
+// Host with an empty address, listening on port; otherwise joins address
+bool NetOpen(NetPeer& n, int port, const string& address, uint32_t seed) {
+    n.player = address.empty() ? 0 : 1;
+    n.seed = seed;
+    n.connected = false;
+    n.rngLoss.Seed(seed, 4 + n.player);
+    n.sock = OpenUdpSocket(address.empty() ? port : 0);
+    if (n.sock == NO_SOCKET) return false;
+    return n.player == 0 || ResolveAddress(address, n.remote);
+}
+
+// Host: waits for a joiner (timeoutMs 0: forever). Joiner: says hello until
+// welcomed. Either way both sides end up with the host's seed.
+bool NetWaitConnected(NetPeer& n, int timeoutMs) {
+    auto start = steady_clock::now();
+    auto nextHello = start;
+    while (!n.connected) {
+        auto now = steady_clock::now();
+        if (timeoutMs > 0 && now - start > milliseconds(timeoutMs)) return false;
+        if (n.player == 1 && now >= nextHello) {
+            NetPacket hello = NetHeader(n, NET_HELLO);
+            NetSendPacket(n, hello, NET_HEADER_SIZE);
+            nextHello = now + milliseconds(100);
+        }
+        NetFlushDelayed(n);
+        NetReceive(n);
+        this_thread::sleep_for(milliseconds(2));
+    }
+    return true;
+}
+
+// Bytes EncodeState() needs for g with every pool full
+size_t MaxEncodedStateSize(const GameState& g) {
+    vector<char> state;
+    EncodeState(g, state);
+    int bullets = g.playerBullets.capacity() - g.playerBullets.size() + g.enemyBullets.capacity() - g.enemyBullets.size();
+    return state.size() + sizeof(Object) * (g.enemies.capacity() - g.enemies.size()) + 4 * sizeof(float) * bullets;
+}
+
+// Call once both sides have set up g the same way
+void NetStart(NetPeer& n, const GameState& g) {
+    n.tick = 0;
+    n.remoteTick = -1;
+    n.remoteAck = -1;
+    n.rollbackFrom = -1;
+    n.latestCheck = -1;
+    n.comparedCheck = -1;
+    n.finished = false;
+    n.lost = false;
+    memset(n.keys, 0, sizeof(n.keys));
+    memset(n.predicted, 0, sizeof(n.predicted));
+    for (int i = 0; i < NET_CHECKS; i++) n.checkTicks[i] = -1;
+    size_t stateSize = MaxEncodedStateSize(g);
+    for (vector<char>& state : n.states) state.reserve(stateSize); // No allocation while playing
+    n.lastHeard = steady_clock::now();
+}
+
+// Saves the state at the start of tick t, then runs it with the keys known
+// or predicted for it
+void NetSimulate(NetPeer& n, GameState& g, int t) {
+    vector<char>& state = n.states[t & (NET_STATES - 1)];
+    state.clear();
+    EncodeState(g, state);
+
+    int other = 1 - n.player, slot = t & (NET_INPUTS - 1);
+    unsigned char remote = t <= n.remoteTick ? n.keys[other][slot]
+                         : n.remoteTick >= 0 ? n.keys[other][n.remoteTick & (NET_INPUTS - 1)] : 0;
+    n.predicted[slot] = remote;
+    unsigned char local = n.keys[n.player][slot];
+    g.inputKeys = n.player == 0 ? local : remote;
+    g.wingKeys = n.player == 0 ? remote : local;
+    g.Input();
+    g.Logic();
+    if (n.endless && !g.gameRunning) g.Setup();
+}
+
+// Re-runs everything from the first mispredicted tick
+void NetRollback(NetPeer& n, GameState& g) {
+    if (n.rollbackFrom < 0) return;
+    int from = n.rollbackFrom;
+    n.rollbackFrom = -1;
+    auto start = steady_clock::now();
+    const vector<char>& state = n.states[from & (NET_STATES - 1)];
+    DecodeState(state.data(), state.size(), g);
+    soundsMuted = true;
+    for (int t = from; t < n.tick; t++) NetSimulate(n, g, t);
+    soundsMuted = false;
+    double us = duration<double, micro>(steady_clock::now() - start).count();
+    n.rollbacks++;
+    n.resimulated += n.tick - from;
+    n.maxRollback = max(n.maxRollback, n.tick - from);
+    n.rollbackUsTotal += us;
+    n.rollbackUsMax = max(n.rollbackUsMax, us);
+}
+
+// Network side of a tick without simulating a new one
+void NetPoll(NetPeer& n, GameState& g) {
+    NetFlushDelayed(n);
+    NetReceive(n);
+    NetRollback(n, g);
+    NetRecordChecks(n);
+    if (steady_clock::now() - n.lastHeard > milliseconds(NET_TIMEOUT_MS)) n.finished = n.lost = true;
+}
+
+// One game tick. Returns false when it could not advance: stalled for the
+// other side, or the game is over (n.finished once both sides agree).
+bool NetTick(NetPeer& n, GameState& g, unsigned char localKeys) {
+    NetPoll(n, g);
+    bool advanced = false;
+    if (n.finished) {
+        // Nothing more to simulate
+    } else if (!g.gameRunning) {
+        // Ended at a tick a late key could still undo, until it is confirmed
+        if (n.tick - 1 <= n.remoteTick) n.finished = true;
+    } else if (n.tick - n.remoteTick > NET_MAX_PREDICTION || n.tick - n.remoteAck >= NET_INPUTS) {
+        n.stalls++;
+    } else {
+        n.keys[n.player][n.tick & (NET_INPUTS - 1)] = localKeys & NET_KEY_MASK;
+        NetSimulate(n, g, n.tick);
+        n.tick++;
+        advanced = true;
+    }
+    NetSendKeys(n);
+    NetFlushDelayed(n);
+    return advanced;
+}
+
+// Keeps answering for a while after the game, so the other side receives
+// our last keys and can confirm the end too
+void NetLinger(NetPeer& n, GameState& g, int ms) {
+    auto end = steady_clock::now() + milliseconds(ms);
+    while (steady_clock::now() < end && !n.lost && (n.remoteAck < n.tick - 1 || n.delayedCount > 0)) {
+        NetPoll(n, g);
+        NetSendKeys(n);
+        this_thread::sleep_for(milliseconds(5));
+    }
+}
+
+void PrintNetStats(ostream& out, const NetPeer& n, const string& indent) {
+    out << indent << "Netplay: " << n.tick << " ticks, " << n.stalls << " stalls, packets " << n.sent << " sent / "
+        << n.dropped << " dropped / " << n.received << " received\n";
+    out << indent << n.rollbacks << " rollbacks (" << n.resimulated << " ticks re-run, deepest " << n.maxRollback
+        << "), " << fixed << setprecision(1) << (n.rollbacks ? n.rollbackUsTotal / n.rollbacks : 0.0) << " us mean / "
+        << n.rollbackUsMax << " us max\n";
+    out << indent << n.checks << " state checks, " << n.desyncs << " desyncs\n";
+}
+
+// ==========================================
+// 16. FRAME RATE CONTROL
+// ==========================================
+
+// Logic() runs at a fixed TICK_RATE from an accumulator, so a slow terminal
+// only lowers the render rate. Waiting for the next tick sleeps while the
+// remaining time comfortably exceeds what a 1 ms sleep has been observed to
+// cost, then spins the rest, which keeps the OS timer granularity out of the
+// tick timing.
+
+struct PacingStats {
+    long long frames = 0, waits = 0, lateFrames = 0;
+    long long skippedRenders = 0, droppedTicks = 0;
+    double overshootSumUs = 0, overshootMaxUs = 0;
+};
+
+PacingStats pacing;
+bool showPacingStats = false;
+
+void WaitUntil(steady_clock::time_point deadline) {
+    // Running mean/variance of the real cost of sleep_for(1 ms), in ns
+    static double sleepMean = 2e6, sleepM2 = 0;
+    static long long sleepSamples = 1;
+
+    auto now = steady_clock::now();
+    if (now >= deadline) {
+        pacing.lateFrames++;
+        return;
+    }
+    while (now < deadline) {
+        double remaining = (double)duration_cast<nanoseconds>(deadline - now).count();
+        double estimate = sleepMean + sqrt(sleepM2 / sleepSamples);
+        if (remaining > estimate) {
+            this_thread::sleep_for(milliseconds(1));
+            auto woke = steady_clock::now();
+            double observed = (double)duration_cast<nanoseconds>(woke - now).count();
+            if (sleepSamples < 1000) sleepSamples++; // Keep adapting to the current timer resolution
+            double delta = observed - sleepMean;
+            sleepMean += delta / sleepSamples;
+            sleepM2 += delta * (observed - sleepMean);
+            now = woke;
+        } else {
+            now = steady_clock::now(); // Spin out the last stretch
+        }
+    }
+    double overshootUs = duration_cast<nanoseconds>(now - deadline).count() / 1000.0;
+    pacing.waits++;
+    pacing.overshootSumUs += overshootUs;
+    pacing.overshootMaxUs = max(pacing.overshootMaxUs, overshootUs);
+}
+
+// Paused with the pause key released: no tick can change anything until a
+// key arrives. Replays never idle, their paused ticks are in the recording.
+bool PausedIdle() {
+    return game.isPaused && !game.pauseKeyHeld && !replaying;
+}
+
+// A netplay game ends when both sides agree it has
+bool GameLoopRunning() {
+    return netplay ? !net.finished : game.gameRunning;
+}
+
+// Runs until the game ends or sits paused; always runs at least one tick so
+// the key that ended a pause gets read. Frames are drawn on the render thread.
+void RunGameLoop() {
+    StartRenderThread();
+    MarkHeap();
+    auto previous = steady_clock::now();
+    long long lag = TICK_NS; // Run the first tick straight away
+    int skippedInRow = 0;
+
+    while (GameLoopRunning()) {
+        auto now = steady_clock::now();
+        lag += duration_cast<nanoseconds>(now - previous).count();
+        previous = now;
+        auto mark = now;
+
+        int ticks = 0;
+        while (lag >= TICK_NS && ticks < MAX_TICKS_PER_FRAME && GameLoopRunning()) {
+            if (replaying && ReplayFinished()) {
+                game.gameRunning = false;
+                break;
+            }
+            if (netplay) {
+                NetTick(net, game, SampleKeyboard()); // Stalls and rollbacks are timed as logic
+                ProfilePhase(PHASE_LOGIC, mark);
+            } else {
+                game.inputKeys = ReadInput();
+                game.Input();
+                ProfilePhase(PHASE_INPUT, mark);
+                game.Logic();
+                ProfilePhase(PHASE_LOGIC, mark);
+            }
+            lag -= TICK_NS;
+            ticks++;
+        }
+        if (lag >= TICK_NS && ticks == MAX_TICKS_PER_FRAME) {
+            pacing.droppedTicks += lag / TICK_NS;
+            lag %= TICK_NS;
+        }
+
+        // Still behind after catching up: skip the render, but not indefinitely
+        bool behind = steady_clock::now() - previous + nanoseconds(lag) >= nanoseconds(TICK_NS);
+        if (ticks > 0) {
+            if (behind && skippedInRow < MAX_SKIPPED_RENDERS) {
+                pacing.skippedRenders++;
+                skippedInRow++;
+            } else {
+                PublishFrame();
+                ProfilePhase(PHASE_DRAW, mark);
+                skippedInRow = 0;
+            }
+        }
+        pacing.frames++;
+
+        WaitUntil(previous + nanoseconds(TICK_NS - lag));
+        ProfilePhase(PHASE_WAIT, mark);
+        ProfileEndFrame(previous, ticks);
+        EndHeapFrame();
+        if (PausedIdle()) break;
+    }
+    StopRenderThread();
+}
+
+void PrintPacingStats(ostream& out) {
+    double meanUs = pacing.waits ? pacing.overshootSumUs / pacing.waits : 0.0;
+    out << "\t\t Frame pacing: " << pacing.frames << " frames, overshoot mean "
+         << fixed << setprecision(1) << meanUs << " us / max " << pacing.overshootMaxUs << " us" << endl;
+    out << "\t\t " << pacing.lateFrames << " late frames, " << pacing.skippedRenders
+         << " skipped renders, " << pacing.droppedTicks << " dropped ticks" << endl;
+    out << "\t\t " << framesPublished << " frames published, " << framesRendered << " drawn, "
+         << framesSuperseded << " superseded before drawing" << endl;
+    out << "\t\t Heap: " << loopHeap.allocations << " allocations (" << loopHeap.bytes << " bytes) in "
+         << allocatingFrames << " frames" << endl;
+}
+
+// ==========================================
+// 17. SCREEN STATE MACHINE
+// ==========================================
+
+// Interactive play is a flat set of screens driven from one loop. Each
+// screen function runs until the screen is left and returns the next one,
+// so moving around the menus never nests calls.
+
+enum ScreenState {
+    SCREEN_MENU,
+    SCREEN_BRIEFING,
+    SCREEN_HOWTO,
+    SCREEN_PLAYING,
+    SCREEN_PAUSED,
+    SCREEN_GAMEOVER,
+    SCREEN_EXIT
+};
+
+unsigned int sessionSeed;
+string sessionRecordPath;
+
+void BuildGameOverPage(bool isNewHighScore, int previousBest, int rank) {
+    Page& page = gameOverPage;
+    ostream out(&page);
+    page.Reset();
+
+    if (isNewHighScore) {
+        page.SetColor(YELLOW);
+        out << "\n\n\n\t\t ############################\n";
+        out << "\t\t #   NEW HIGH SCORE!!!      #\n";
+        out << "\t\t ############################\n";
+        page.SetColor(WHITE);
+        out << "\n\t\t    Your Score: " << game.score << "\n";
+        out << "\t\t    Previous Best: " << previousBest << "\n";
+    } else {
+        page.SetColor(RED);
+        out << "\n\n\n\t\t ############################\n";
+        out << "\t\t #      MISSION FAILED      #\n";
+        out << "\t\t ############################\n";
+        page.SetColor(WHITE);
+        out << "\n\t\t    Your Score: " << game.score << "\n";
+        out << "\t\t    High Score: " << highScore << "\n";
+    }
+    if (rank >= 0) out << "\t\t    Leaderboard rank: " << rank + 1 << "\n";
+
+    page.SetColor(WHITE);
+    out << "\n";
+    PrintLeaderboard(out, "\t\t    ", rank);
+
+    if (showPacingStats) {
+        page.SetColor(CYAN);
+        out << "\n";
+        PrintPacingStats(out);
+    }
+
+    page.SetColor(CYAN);
+    out << "\n\n\t\t Press any key to exit...";
+}
+
+void BuildSavedPage(bool saved) {
+    Page& page = gameOverPage;
+    ostream out(&page);
+    page.Reset();
+    page.SetColor(saved ? GREEN : RED);
+    out << "\n\n\n\t\t ############################\n";
+    out << (saved ? "\t\t #      MISSION SAVED       #\n" : "\t\t #   COULD NOT SAVE RUN     #\n");
+    out << "\t\t ############################\n";
+    page.SetColor(WHITE);
+    out << "\n\t\t    Score so far: " << game.score << "\n";
+    if (saved) out << "\t\t    Press R on the menu to resume\n";
+    else out << "\t\t    Cannot write " << QUICKSAVE_FILE << "\n";
+    page.SetColor(CYAN);
+    out << "\n\n\t\t Press any key to exit...";
+}
+
+void BuildNetplayPage() {
+    Page& page = gameOverPage;
+    ostream out(&page);
+    page.Reset();
+    page.SetColor(net.lost ? RED : YELLOW);
+    out << "\n\n\n\t\t ############################\n";
+    out << (net.lost ? "\t\t #     CONNECTION LOST      #\n" : "\t\t #      MISSION OVER        #\n");
+    out << "\t\t ############################\n";
+    page.SetColor(WHITE);
+    out << "\n\t\t    Team Score: " << game.score << "\n\n";
+    page.SetColor(CYAN);
+    PrintNetStats(out, net, "\t\t ");
+    if (showPacingStats) {
+        out << "\n";
+        PrintPacingStats(out);
+    }
+    out << "\n\n\t\t Press any key to exit...";
+}
+
+ScreenState RunMenuScreen() {
+    PlayMenuSound();
+    // Sleeps in the console until a key arrives, waking only to blink the logo
+    bool blink = true;
+    do {
+        ShowPage(menuPages[blink]);
+        blink = !blink;
+    } while (!console->WaitForKey(MENU_BLINK_MS));
+
+    char ch = (char)console->ReadKey();
+    if (ch == '2') return SCREEN_BRIEFING;
+    if (ch == '3') return SCREEN_HOWTO;
+    if (ch == '4') return SCREEN_EXIT;
+    if ((ch == 'r' || ch == 'R') && !quicksave.empty() && RestoreSnapshot(quicksave, game)) {
+        // Comes back paused, so the player gets to look at the board first.
+        // Not recorded: a recording has to start from Setup().
+        game.gameRunning = true;
+        game.isPaused = true;
+        game.pauseKeyHeld = false;
+        quicksaveOwned = true;
+        quicksaveTick = game.frameCounter;
+    } else {
+        game.Setup(); // Any other key starts the mission
+        if (!sessionRecordPath.empty()) StartRecording();
+    }
+    ClearBackPlanes();
+    shownRows = PROFILER_ROW + 1;
+    return SCREEN_PLAYING;
+}
+
+// Static pages: shown until any key is pressed
+ScreenState RunPageScreen(const Page& page) {
+    ShowPage(page);
+    console->ReadKey();
+    return SCREEN_MENU;
+}
+
+ScreenState RunPlayingScreen() {
+    RunGameLoop();
+    if (netplay) { // Never recorded, saved or ranked: the run belongs to two players
+        NetLinger(net, game, 1000);
+        BuildNetplayPage();
+        return SCREEN_GAMEOVER;
+    }
+    if (game.gameRunning) return SCREEN_PAUSED;
+
+    if (recording && !SaveRecording(sessionRecordPath, sessionSeed)) {
+        cerr << "Cannot write recording: " << sessionRecordPath << endl;
+    }
+    if (game.playerHP > 0) { // Quit with ESC: keep the run for later
+        BuildSavedPage(SaveQuicksave());
+        return SCREEN_GAMEOVER;
+    }
+    DropQuicksave();
+    int previousBest = highScore;
+    bool isNewHighScore = game.score > highScore;
+    int rank = SubmitRun(game.score, (uint32_t)game.frameCounter);
+    if (isNewHighScore) PlayHighScoreSound();
+    else PlayExplosionSound();
+    BuildGameOverPage(isNewHighScore, previousBest, rank);
+    return SCREEN_GAMEOVER;
+}
+
+// Draws the paused board once and blocks until a key arrives. Pausing is
+// also the quicksave key: the run survives the game being closed from here.
+ScreenState RunPausedScreen() {
+    SaveQuicksave();
+    Draw();
+    console->WaitForKey(-1);
+    return SCREEN_PLAYING;
+}
+
+ScreenState RunScreen(ScreenState state) {
+    switch (state) {
+        case SCREEN_MENU:     return RunMenuScreen();
+        case SCREEN_BRIEFING: return RunPageScreen(briefingPage);
+        case SCREEN_HOWTO:    return RunPageScreen(howToPage);
+        case SCREEN_PLAYING:  return RunPlayingScreen();
+        case SCREEN_PAUSED:   return RunPausedScreen();
+        case SCREEN_GAMEOVER:
+            ShowPage(gameOverPage);
+            console->ReadKey();
+            return SCREEN_EXIT;
+        default:              return SCREEN_EXIT;
+    }
+}
+
+void RunScreens(unsigned int seed, const string& recordPath) {
+    sessionSeed = seed;
+    sessionRecordPath = recordPath;
+    BuildMenuPages();
+    BuildBriefingPage(briefingPage);
+    BuildHowToPage(howToPage);
+
+    InvalidateFrame(); // Clears whatever the shell left on screen
+    ScreenState state = SCREEN_MENU;
+    if (netplay) { // Straight into the shared game
+        game.twoPlayers = true;
+        game.Setup();
+        NetStart(net, game);
+        ClearBackPlanes();
+        shownRows = PROFILER_ROW + 1;
+        state = SCREEN_PLAYING;
+    }
+    while (state != SCREEN_EXIT) state = RunScreen(state);
+}
+
+// ==========================================
+// 18. HEADLESS SIMULATION
+// ==========================================
+
+// Runs Logic() flat out on scripted input with no console, sound or frame
+// pacing, so simulation throughput can be tracked between releases.
+
+struct ScriptStep {
+    int ticks;
+    unsigned char keys;
+};
+
+vector<ScriptStep> inputScript;
+
+// Used when no --script is given: keep firing while sweeping the arena
+const ScriptStep DEFAULT_SCRIPT[] = {
+    { 30, KEY_FIRE | KEY_UP },
+    { 10, KEY_FIRE | KEY_RIGHT },
+    { 30, KEY_FIRE | KEY_DOWN },
+    { 1,  KEY_FIRE | KEY_BOMB },
+    { 10, KEY_FIRE | KEY_LEFT },
+    { 20, KEY_FIRE },
+};
+
+unsigned char ParseKeyName(const string& name) {
+    if (name == "UP") return KEY_UP;
+    if (name == "DOWN") return KEY_DOWN;
+    if (name == "LEFT") return KEY_LEFT;
+    if (name == "RIGHT") return KEY_RIGHT;
+    if (name == "FIRE" || name == "SPACE") return KEY_FIRE;
+    if (name == "BOMB" || name == "B") return KEY_BOMB;
+    if (name == "PAUSE" || name == "P") return KEY_PAUSE;
+    if (name == "ESC" || name == "QUIT") return KEY_QUIT;
+    return 0;
+}
+
+// Script format: one step per line, "<ticks> [KEY ...]", '#' starts a comment.
+// e.g. "40 UP FIRE" holds up and fire for 40 ticks. The script loops.
+bool LoadInputScript(const string& path) {
+    ifstream file(path);
+    if (!file.is_open()) return false;
+    string line;
+    while (getline(file, line)) {
+        size_t hash = line.find('#');
+        if (hash != string::npos) line.erase(hash);
+        istringstream words(line);
+        ScriptStep step = { 0, 0 };
+        if (!(words >> step.ticks) || step.ticks <= 0) continue;
+        string key;
+        while (words >> key) step.keys |= ParseKeyName(key);
+        inputScript.push_back(step);
+    }
+    return !inputScript.empty();
+}
+
+unsigned char ScriptedKeys(long long tick) {
+    static size_t step = 0;
+    static long long stepEnd = 0;
+    if (tick == 0) { step = 0; stepEnd = inputScript[0].ticks; }
+    while (tick >= stepEnd) {
+        step = (step + 1) % inputScript.size();
+        stepEnd += inputScript[step].ticks;
+    }
+    return inputScript[step].keys;
+}
+
+// Heap use is counted after a warm-up; checkHeap also draws every tick (into
+// the null console) and fails the run if gameplay allocated at all
+const long long HEAP_WARMUP_TICKS = 10 * TICK_RATE;
+
+// checkSnapshot saves the game to a file every SNAPSHOT_CHECK_TICKS and
+// resumes it into a new GameState, set up from another seed so that any
+// field the snapshot missed shows. The copy must re-encode to the same bytes
+// straight away, then plays on alongside the original with the same input
+// and has to match the uninterrupted game after every tick.
+const long long SNAPSHOT_CHECK_TICKS = 10 * TICK_RATE;
+const string SNAPSHOT_CHECK_FILE = "snapshot-check.dat";
+
+int RunHeadless(unsigned int seed, long long ticks, const string& scriptPath, const string& recordPath, bool checkHeap,
+                bool checkSnapshot) {
+    if (!scriptPath.empty()) {
+        if (!LoadInputScript(scriptPath)) {
+            cerr << "Cannot read input script: " << scriptPath << endl;
+            return 1;
+        }
+    } else {
+        inputScript.assign(begin(DEFAULT_SCRIPT), end(DEFAULT_SCRIPT));
+    }
+
+    SeedRandom(seed);
+    game.Setup();
+    if (!recordPath.empty()) StartRecording();
+    if (checkHeap) InitRenderer();
+
+    unique_ptr<GameState> resumed;
+    vector<char> snapshot;
+    long long snapshotChecks = 0, snapshotMismatches = 0;
+    double snapshotSaveUs = 0, snapshotLoadUs = 0;
+
+    long long games = 1;
+    int peakEnemies = 0, peakBullets = 0;
+    long long sweptHits = 0; // Over all games
+    HeapCount heapStart = gameHeap;
+    auto start = steady_clock::now();
+    for (long long t = 0; t < ticks; t++) {
+        if (t == HEAP_WARMUP_TICKS) heapStart = gameHeap;
+        if (checkSnapshot && t % SNAPSHOT_CHECK_TICKS == 0) {
+            HeapCount* counter = heapCounter; // The check's file I/O is not gameplay
+            heapCounter = NULL;
+            auto saveStart = steady_clock::now();
+            bool ok = SaveSnapshot(game, SNAPSHOT_CHECK_FILE);
+            auto loadStart = steady_clock::now();
+            resumed.reset(new GameState());
+            resumed->Seed(~seed);
+            resumed->Setup();
+            string error;
+            ok = ok && LoadSnapshot(SNAPSHOT_CHECK_FILE, snapshot, error) && RestoreSnapshot(snapshot, *resumed);
+            auto loadEnd = steady_clock::now();
+            snapshotSaveUs += duration<double, micro>(loadStart - saveStart).count();
+            snapshotLoadUs += duration<double, micro>(loadEnd - loadStart).count();
+            if (ok) EncodeSnapshot(*resumed);
+            if (!ok || snapshotBuffer != snapshot) snapshotMismatches++;
+            snapshotChecks++;
+            heapCounter = counter;
+        }
+        game.inputKeys = ScriptedKeys(t);
+        if (recording) RecordKeys(game.inputKeys);
+        game.Input();
+        game.Logic();
+        if (checkSnapshot) {
+            resumed->inputKeys = game.inputKeys;
+            resumed->Input();
+            resumed->Logic();
+            if (resumed->StateHash() != game.StateHash()) snapshotMismatches++;
+        }
+        if (checkHeap) Draw();
+        peakEnemies = max(peakEnemies, game.enemies.size());
+        peakBullets = max(peakBullets, game.playerBullets.size() + game.enemyBullets.size());
+        if (!game.gameRunning) sweptHits += game.sweptHits;
+        if (!game.gameRunning && recording) { // A recording covers exactly one game
+            ticks = t + 1;
+            break;
+        }
+        if (!game.gameRunning && t + 1 < ticks) { // Keep the workload fixed: start another game
+            games++;
+            game.Setup();
+            if (checkSnapshot) resumed->Setup();
+        }
+    }
+    if (game.gameRunning) sweptHits += game.sweptHits;
+    double seconds = duration<double>(steady_clock::now() - start).count();
+    long long heapAllocations = gameHeap.allocations - heapStart.allocations, heapBytes = gameHeap.bytes - heapStart.bytes;
+    StopAudio();
+
+    cout << "NISHIT-WARRIORS headless run" << endl;
+    cout << "  seed:       " << seed << endl;
+    cout << "  ticks:      " << ticks << endl;
+    cout << "  elapsed:    " << fixed << setprecision(3) << seconds << " s" << endl;
+    cout << "  ticks/sec:  " << setprecision(0) << (seconds > 0 ? ticks / seconds : 0.0) << endl;
+    cout << "  games:      " << games << endl;
+    cout << "  score:      " << game.score << " (frame " << game.frameCounter << ", HP " << game.playerHP << ")" << endl;
+    cout << "  enemies:    " << game.enemies.size() << " (peak " << peakEnemies << ")" << endl;
+    cout << "  bullets:    " << game.playerBullets.size() + game.enemyBullets.size() << " (peak " << peakBullets << ")" << endl;
+    cout << "  swept hits: " << sweptHits << " (missed by an end-of-tick overlap test)" << endl;
+    cout << "  heap:       " << heapAllocations << " allocations (" << heapBytes << " bytes)"
+         << (ticks > HEAP_WARMUP_TICKS ? " after warm-up" : " (run shorter than the warm-up)")
+         << (checkHeap ? ", ticks drawn" : "") << endl;
+    if (audioSink != AUDIO_OFF) {
+        cout << "  audio:      " << soundsPosted << " posted, " << soundsPlayed << " played, "
+             << soundsCoalesced << " coalesced, " << soundsStale << " stale, " << soundsDropped << " dropped" << endl;
+    }
+    cout << "  state hash: " << hex << setw(16) << setfill('0') << game.StateHash() << dec << endl;
+    if (checkSnapshot) {
+        remove(SNAPSHOT_CHECK_FILE.c_str());
+        cout << "  snapshot:   " << snapshotChecks << " round trips of " << snapshot.size() << " bytes, save "
+             << setprecision(1) << snapshotSaveUs / snapshotChecks << " us, load " << snapshotLoadUs / snapshotChecks
+             << " us: " << (snapshotMismatches ? "MISMATCH" : "MATCH") << endl;
+    }
+    if (recording && !SaveRecording(recordPath, seed)) {
+        cerr << "Cannot write recording: " << recordPath << endl;
+        return 1;
+    }
+    if (checkHeap && ticks <= HEAP_WARMUP_TICKS) {
+        cerr << "Heap check needs more than " << HEAP_WARMUP_TICKS << " ticks" << endl;
+        return 1;
+    }
+    if (checkHeap && heapAllocations > 0) {
+        cerr << "Heap check failed: steady-state gameplay allocated" << endl;
+        return 1;
+    }
+    if (snapshotMismatches > 0) {
+        cerr << "Snapshot check failed: a resumed game differed from the uninterrupted one" << endl;
+        return 1;
+    }
+    return 0;
+}
+
+// Netplay over loopback: a host and a joiner play on their own threads in
+// real time, talking UDP over 127.0.0.1 through the injected latency and
+// loss. The host flies the first ship from the input script, the joiner the
+// second from the same script mirrored. Every tick of the shared game then
+// has to come out as in a plain two-player simulation of the same keys.
+const int NETPLAY_TEST_TICKS = 20 * TICK_RATE;
+const int NETPLAY_TEST_TIMEOUT_MS = 5000;
+
+unsigned char MirrorKeys(unsigned char keys) {
+    unsigned char mirrored = keys & (unsigned char)~(KEY_UP | KEY_DOWN);
+    if (keys & KEY_UP) mirrored |= KEY_DOWN;
+    if (keys & KEY_DOWN) mirrored |= KEY_UP;
+    return mirrored;
+}
+
+// One side's thread; ok when every tick was confirmed by both sides' keys
+void PlayNetplayTest(NetPeer& n, GameState& g, const vector<unsigned char>& keys, int ticks, bool& ok) {
+    ok = false;
+    if (!NetWaitConnected(n, NETPLAY_TEST_TIMEOUT_MS)) return;
+    g.Seed(n.seed);
+    g.twoPlayers = true;
+    g.Setup();
+    n.endless = true;
+    NetStart(n, g);
+
+    auto next = steady_clock::now();
+    while (n.tick < ticks && !n.finished) {
+        NetTick(n, g, keys[n.tick]);
+        next += nanoseconds(TICK_NS);
+        this_thread::sleep_until(next);
+    }
+    // Until both sides hold every key, then a little longer so the other
+    // side hears our final ack even if packets get lost
+    auto deadline = steady_clock::now() + milliseconds(NETPLAY_TEST_TIMEOUT_MS);
+    auto tail = steady_clock::time_point::max();
+    while (!n.finished && steady_clock::now() < min(deadline, tail)) {
+        NetPoll(n, g);
+        NetSendKeys(n);
+        NetFlushDelayed(n);
+        if (tail == steady_clock::time_point::max() && n.remoteTick >= ticks - 1 && n.remoteAck >= ticks - 1) {
+            tail = steady_clock::now() + milliseconds(250 + 4 * n.latencyMs);
+        }
+        this_thread::sleep_for(milliseconds(1));
+    }
+    ok = n.tick == ticks && n.remoteTick >= ticks - 1 && n.rollbackFrom < 0 && !n.lost;
+}
+
+int RunNetplayTest(unsigned int seed, int ticks, const string& scriptPath, int latencyMs, int lossPercent) {
+    if (!scriptPath.empty()) {
+        if (!LoadInputScript(scriptPath)) {
+            cerr << "Cannot read input script: " << scriptPath << endl;
+            return 1;
+        }
+    } else {
+        inputScript.assign(begin(DEFAULT_SCRIPT), end(DEFAULT_SCRIPT));
+    }
+    vector<unsigned char> keys[2];
+    for (int t = 0; t < ticks; t++) {
+        unsigned char k = ScriptedKeys(t) & NET_KEY_MASK;
+        keys[0].push_back(k);
+        keys[1].push_back(MirrorKeys(k));
+    }
+
+    // The same game without a network in between
+    unique_ptr<GameState> reference(new GameState());
+    reference->Seed(seed);
+    reference->twoPlayers = true;
+    reference->Setup();
+    for (int t = 0; t < ticks; t++) {
+        reference->inputKeys = keys[0][t];
+        reference->wingKeys = keys[1][t];
+        reference->Input();
+        reference->Logic();
+        if (!reference->gameRunning) reference->Setup();
+    }
+
+    unique_ptr<NetPeer> peers[2] = { unique_ptr<NetPeer>(new NetPeer()), unique_ptr<NetPeer>(new NetPeer()) };
+    unique_ptr<GameState> games[2] = { unique_ptr<GameState>(new GameState()), unique_ptr<GameState>(new GameState()) };
+    for (auto& n : peers) { n->latencyMs = latencyMs; n->lossPercent = lossPercent; }
+    if (!NetOpen(*peers[0], 0, "", seed) ||
+        !NetOpen(*peers[1], 0, "127.0.0.1:" + to_string(BoundPort(peers[0]->sock)), 0)) {
+        cerr << "Cannot open loopback sockets" << endl;
+        return 1;
+    }
+    bool ok[2];
+    thread host(PlayNetplayTest, ref(*peers[0]), ref(*games[0]), cref(keys[0]), ticks, ref(ok[0]));
+    thread joiner(PlayNetplayTest, ref(*peers[1]), ref(*games[1]), cref(keys[1]), ticks, ref(ok[1]));
+    host.join();
+    joiner.join();
+    for (auto& n : peers) CloseUdpSocket(n->sock);
+
+    unsigned long long expected = reference->StateHash();
+    bool match = true;
+    cout << "NISHIT-WARRIORS netplay loopback test" << endl;
+    cout << "  seed:       " << seed << ", " << ticks << " ticks, latency " << latencyMs << " ms, loss " << lossPercent << "%" << endl;
+    for (int i = 0; i < 2; i++) {
+        unsigned long long hash = games[i]->StateHash();
+        match = match && ok[i] && hash == expected && peers[i]->desyncs == 0;
+        cout << (i == 0 ? "  host" : "  joiner") << endl;
+        PrintNetStats(cout, *peers[i], "    ");
+        cout << "    state hash " << hex << setw(16) << setfill('0') << hash << dec << setfill(' ')
+             << (ok[i] ? "" : " (did not finish)") << endl;
+    }
+    cout << "  expected:   " << hex << setw(16) << setfill('0') << expected << dec << setfill(' ') << endl;
+    cout << "  result:     " << (match ? "MATCH" : "MISMATCH") << endl;
+    return match ? 0 : 1;
+}
+
+// Batch mode plays many seeded games at once, one GameState per worker
+// thread, to get score and survival distributions for balancing changes.
+// Game i always uses seed + i and the pilot below, so the aggregate is the
+// same whatever the thread count.
+
+// Scripted pilot: keeps firing, stays near the left edge, dodges bullets and
+// incoming fighters, picks up boost packs and otherwise lines up with the
+// boss or the nearest enemy. Reads only the game state, so it is deterministic.
+unsigned char PilotKeys(const GameState& g) {
+    unsigned char keys = KEY_FIRE;
+    if (g.bossActive && g.hasBomb) keys |= KEY_BOMB;
+    if (g.playerX > 12) keys |= KEY_LEFT;
+
+    // Anything about to hit the current row?
+    bool danger = false;
+    int dangerY = g.playerY;
+    for (int i = 0; i < g.enemyBullets.size() && !danger; i++) {
+        float dx = g.enemyBullets.x[i] - (float)g.playerX;
+        int by = (int)g.enemyBullets.y[i];
+        if (dx > -4.0f && dx < 16.0f && abs(by - g.playerY) <= 1) { danger = true; dangerY = by; }
+    }
+    for (const Object& e : g.enemies) {
+        if (danger) break;
+        if (e.type == 0 && e.x - g.playerX < 14 && e.x - g.playerX > -6 && abs(e.y - g.playerY) < 3) {
+            danger = true;
+            dangerY = e.y;
+        }
+    }
+    if (danger) {
+        bool goUp = dangerY >= g.playerY;
+        if (goUp && g.playerY <= 3) goUp = false;
+        if (!goUp && g.playerY >= g.arena.height - 4) goUp = true;
+        return keys | (goUp ? KEY_UP : KEY_DOWN);
+    }
+
+    int targetY = -1;
+    if (g.boostPack.active && g.playerHP < 80) {
+        targetY = g.boostPack.y;
+    } else {
+        int nearestX = g.arena.width * 2;
+        for (const Object& e : g.enemies) {
+            if (e.type == 1) { targetY = e.y; break; }
+            if (e.x > g.playerX + 6 && e.x < nearestX) { nearestX = e.x; targetY = e.y; }
+        }
+    }
+    if (targetY >= 0 && targetY < g.playerY - 1) keys |= KEY_UP;
+    else if (targetY > g.playerY + 1) keys |= KEY_DOWN;
+    return keys;
+}
+
+struct BatchResult {
+    int score;
+    int ticks;  // Survived, capped at the batch's tick limit
+    int bosses;
+};
+
+int Percentile(vector<int> values, int pct) {
+    if (values.empty()) return 0;
+    size_t k = min(values.size() - 1, values.size() * pct / 100);
+    nth_element(values.begin(), values.begin() + k, values.end());
+    return values[k];
+}
+
+void PrintDistribution(const char* label, const vector<int>& values) {
+    double mean = 0;
+    for (int v : values) mean += v;
+    mean /= max<size_t>(1, values.size());
+    cout << label << fixed << setprecision(1) << "mean " << mean
+         << ", p10 " << Percentile(values, 10) << ", p50 " << Percentile(values, 50)
+         << ", p90 " << Percentile(values, 90)
+         << ", max " << (values.empty() ? 0 : *max_element(values.begin(), values.end())) << endl;
+}
+
+int RunBatch(int games, int threads, unsigned int seed, long long maxTicks) {
+    if (threads <= 0) threads = max(1u, thread::hardware_concurrency());
+    threads = min(threads, games);
+    vector<BatchResult> results(games);
+    atomic<int> nextGame(0);
+    atomic<long long> totalTicks(0);
+
+    auto worker = [&]() {
+        unique_ptr<GameState> g(new GameState()); // Too big for a thread stack
+        long long ticks = 0;
+        for (int i = nextGame.fetch_add(1); i < games; i = nextGame.fetch_add(1)) {
+            g->Seed(seed + (unsigned int)i);
+            g->Setup();
+            long long t = 0;
+            while (g->gameRunning && t < maxTicks) {
+                g->inputKeys = PilotKeys(*g);
+                g->Input();
+                g->Logic();
+                t++;
+            }
+            results[i] = { g->score, (int)t, g->bossesKilled };
+            ticks += t;
+        }
+        totalTicks += ticks;
+    };
+
+    auto start = steady_clock::now();
+    vector<thread> pool;
+    for (int t = 1; t < threads; t++) pool.emplace_back(worker);
+    worker();
+    for (thread& t : pool) t.join();
+    double seconds = duration<double>(steady_clock::now() - start).count();
+
+    vector<int> scores, survival;
+    vector<int> bossCounts;
+    unsigned long long h = FNV_OFFSET;
+    int survivors = 0;
+    for (const BatchResult& r : results) {
+        scores.push_back(r.score);
+        survival.push_back(r.ticks);
+        if (r.bosses >= (int)bossCounts.size()) bossCounts.resize(r.bosses + 1);
+        bossCounts[r.bosses]++;
+        if (r.ticks >= maxTicks) survivors++;
+        h = HashValue(h, r.score); h = HashValue(h, r.ticks); h = HashValue(h, r.bosses);
+    }
+
+    cout << "NISHIT-WARRIORS batch run" << endl;
+    cout << "  games:      " << games << " (seeds " << seed << ".." << seed + (unsigned int)(games - 1)
+         << ", " << maxTicks << " ticks max)" << endl;
+    cout << "  threads:    " << threads << endl;
+    cout << "  elapsed:    " << fixed << setprecision(3) << seconds << " s" << endl;
+    cout << "  games/sec:  " << setprecision(1) << (seconds > 0 ? games / seconds : 0.0) << endl;
+    cout << "  ticks/sec:  " << setprecision(0) << (seconds > 0 ? totalTicks / seconds : 0.0) << endl;
+    PrintDistribution("  score:      ", scores);
+    PrintDistribution("  survival:   ", survival);
+    cout << "  survivors:  " << survivors << " reached the tick limit" << endl;
+    cout << "  boss kills: ";
+    for (size_t b = 0; b < bossCounts.size(); b++) {
+        if (bossCounts[b]) cout << b << ":" << bossCounts[b] << " ";
+    }
+    cout << endl;
+    cout << "  batch hash: " << hex << setw(16) << setfill('0') << h << dec << setfill(' ') << endl;
+    return 0;
+}
+
+// Stress mode runs the real Input()/Logic() and Draw() on an enlarged arena
+// with the entity caps lifted, sweeping the enemy cap from tens to tens of
+// thousands (or one cap with --enemy-cap), and reports the cost per tick of
+// each so the scaling curve shows where it bends. The pilot plays, but its
+// own time is not counted. Draw() renders into the null console.
+const int STRESS_CAPS[] = { 10, 30, 100, 300, 1000, 3000, 10000, 30000 };
+const int STRESS_WARMUP_TICKS = 400; // Long enough for spawns to cross the default arena
+const long long STRESS_TICKS = 500;  // Measured ticks per step unless --ticks is given
+
+struct StressStep {
+    double enemies, bullets; // Means over the measured ticks
+    double bossShare;        // Share of measured ticks with a boss up
+    double logicNs, drawNs;
+    int logicP99, drawP99;
+};
+
+StressStep RunStressStep(const Arena& arena, unsigned int seed, long long ticks) {
+    game.Configure(arena);
+    game.Seed(seed);
+    game.Setup();
+    InitRenderer();
+
+    StressStep step = {};
+    vector<int> logicNs, drawNs;
+    logicNs.reserve(ticks);
+    drawNs.reserve(ticks);
+    for (long long t = 0; t < STRESS_WARMUP_TICKS + ticks; t++) {
+        game.inputKeys = PilotKeys(game);
+        auto start = steady_clock::now();
+        game.Input();
+        game.Logic();
+        auto logicEnd = steady_clock::now();
+        Draw();
+        auto drawEnd = steady_clock::now();
+        if (t < STRESS_WARMUP_TICKS) continue;
+        logicNs.push_back((int)duration_cast<nanoseconds>(logicEnd - start).count());
+        drawNs.push_back((int)duration_cast<nanoseconds>(drawEnd - logicEnd).count());
+        step.enemies += game.enemies.size();
+        step.bullets += game.playerBullets.size() + game.enemyBullets.size();
+        step.bossShare += game.bossActive;
+        step.logicNs += logicNs.back();
+        step.drawNs += drawNs.back();
+    }
+    step.enemies /= ticks; step.bullets /= ticks; step.bossShare /= ticks;
+    step.logicNs /= ticks; step.drawNs /= ticks;
+    step.logicP99 = Percentile(logicNs, 99);
+    step.drawP99 = Percentile(drawNs, 99);
+    return step;
+}
+
+// arena carries the size and any explicit caps; zero caps are filled per step
+int RunStress(Arena arena, int enemyCap, int spawnPerWave, unsigned int seed, long long ticks) {
+    if (arena.width < 40 || arena.height < 12) {
+        cerr << "Stress arena must be at least 40 x 12" << endl;
+        return 1;
+    }
+    vector<int> caps(begin(STRESS_CAPS), end(STRESS_CAPS));
+    if (enemyCap > 0) caps.assign(1, enemyCap);
+
+    cout << "NISHIT-WARRIORS stress run" << endl;
+    cout << "  arena:  " << arena.width << " x " << arena.height << ", seed " << seed << ", "
+         << STRESS_WARMUP_TICKS << " warm-up + " << ticks << " measured ticks per step" << endl;
+    cout << "     cap   enemies  bullets  boss   logic us/tick (p99)    draw us/tick (p99)   logic ns/entity" << endl;
+    for (int cap : caps) {
+        Arena a = arena;
+        a.maxEnemies = cap + 1 + MAX_BOSS_ESCORTS; // Room for a boss on top of a full wave
+        a.enemyCap = a.bossEnemyCap = cap;
+        a.maxBullets = max(arena.maxBullets, cap);
+        a.spawnPerWave = spawnPerWave > 0 ? spawnPerWave : cap / 8 + 1; // Reaches the cap within a few waves
+        StressStep s = RunStressStep(a, seed, ticks);
+        double entities = max(1.0, s.enemies + s.bullets);
+        cout << fixed << setprecision(1)
+             << setw(8) << cap << setw(10) << s.enemies << setw(9) << s.bullets << setw(5) << (int)(s.bossShare * 100) << "%"
+             << setw(12) << s.logicNs / 1000 << " (" << setw(8) << s.logicP99 / 1000.0 << ")"
+             << setw(12) << s.drawNs / 1000 << " (" << setw(8) << s.drawP99 / 1000.0 << ")"
+             << setw(14) << s.logicNs / entities << endl;
+    }
+    return 0;
+}
+
+// Plays a recording back through Input()/Logic(), either paced and rendered
+// like a live game or flat out with no console, then checks the final state
+int RunReplay(const string& path, bool fast) {
+    if (!LoadRecording(path)) {
+        cerr << "Cannot read recording: " << path;
+        if (memcmp(replayHeader.magic, "NWRP", 4) == 0 && replayHeader.version != REPLAY_VERSION)
+            cerr << " (format version " << replayHeader.version << ", this build plays version " << REPLAY_VERSION << ")";
+        cerr << endl;
+        return 1;
+    }
+    SeedRandom(replayHeader.seed);
+    game.Setup();
+    replaying = true;
+
+    auto start = steady_clock::now();
+    if (fast) {
+        while (game.gameRunning && !ReplayFinished()) {
+            game.inputKeys = ReadInput();
+            game.Input();
+            game.Logic();
+        }
+    } else {
+        console = &systemConsole;
+        console->Open();
+        InitRenderer();
+        RunGameLoop();
+        Gotoxy(0, PROFILER_ROW + 1);
+        Color(WHITE);
+        console->Put('\n');
+        CloseConsole();
+        console = &nullConsole;
+    }
+    double seconds = duration<double>(steady_clock::now() - start).count();
+    StopAudio();
+
+    bool match = ReplayMatches();
+    cout << "NISHIT-WARRIORS replay " << path << endl;
+    cout << "  seed:       " << replayHeader.seed << endl;
+    cout << "  ticks:      " << replayTicks << " of " << replayHeader.ticks << " in "
+         << fixed << setprecision(3) << seconds << " s" << endl;
+    cout << "  score:      " << game.score << endl;
+    cout << "  swept hits: " << game.sweptHits << " (missed by an end-of-tick overlap test)" << endl;
+    cout << "  state hash: " << hex << setw(16) << setfill('0') << game.StateHash()
+         << " (recorded " << setw(16) << replayHeader.finalHash << ")" << dec << endl;
+    cout << "  result:     " << (match ? "MATCH" : "MISMATCH") << endl;
+    return match ? 0 : 1;
+}
+
+// Capture playback. The file is read whole and indexed once; the index pass
+// also checks that the deltas before each keyframe rebuilt exactly the board
+// that keyframe holds, so a clean pass means every frame decodes as captured.
+struct CaptureFrameInfo {
+    size_t offset;
+    long long timeUs, tick;
+    int key; // Index of the keyframe this frame decodes from
+    bool board, paused; // board: the record stores the board, not just the time
+};
+
+const long long STUTTER_US = 4 * 1000000LL / TICK_RATE; // A frame this late is reported
+
+vector<unsigned char> watchData; // Unpacked records
+size_t watchFileBytes = 0;
+vector<CaptureFrameInfo> watchFrames;
+FrameSnapshot watchFrame;
+int watchShown = -1; // Frame currently decoded into watchFrame
+
+// Decodes the record at p onto f; false on a truncated or corrupt record.
+// For keyframes, shown is the recorded hash of the board before it.
+bool DecodeCaptureFrame(const unsigned char*& p, const unsigned char* end, FrameSnapshot& f,
+                        long long& timeUs, long long& tick, unsigned long long& shown) {
+    unsigned long long t, ticks, n;
+    if (p >= end || (*p != 'K' && *p != 'D' && *p != 'T')) return false;
+    unsigned char kind = *p++;
+    bool key = kind == 'K';
+    if (!GetVarint(p, end, t) || !GetVarint(p, end, ticks)) return false;
+    timeUs = key ? (long long)t : timeUs + (long long)t;
+    tick = key ? (long long)ticks : tick + (long long)ticks;
+    if (kind == 'T') return true;
+    if (key) {
+        if (end - p < (long)sizeof(shown)) return false;
+        memcpy(&shown, p, sizeof(shown));
+        p += sizeof(shown);
+        f.board.Fill(0);
+        f.colors.Fill(WHITE);
+    }
+    if (p >= end) return false;
+
+    unsigned char mask = *p++;
+    int* fields[] = { &f.score, &f.highScore, &f.playerHP, &f.bossHP };
+    for (int k = 0; k < 4; k++) {
+        if (!(mask & (1 << k))) continue;
+        if (!GetVarint(p, end, n)) return false;
+        *fields[k] = UnZigZag(n);
+    }
+    if (mask & (1 << HUD_DIFFICULTY)) {
+        if (end - p < (long)sizeof(float)) return false;
+        memcpy(&f.difficulty, p, sizeof(float));
+        p += sizeof(float);
+    }
+    if (mask & (1 << HUD_FLAGS)) {
+        if (p >= end) return false;
+        f.hasBomb = *p & 1; f.bossActive = (*p >> 1) & 1; f.paused = (*p >> 2) & 1;
+        p++;
+    }
+
+    char* chars = f.board.cells.data();
+    unsigned char* colors = f.colors.cells.data();
+    const size_t cells = f.board.cells.size();
+    size_t i = 0;
+    while (true) {
+        if (!GetVarint(p, end, n)) return false;
+        if (n == 0) break;
+        size_t count = (size_t)(n >> 1);
+        if (count > cells - i) return false;
+        if (n & 1) {
+            if (end - p < 2) return false;
+            memset(chars + i, p[0], count);
+            memset(colors + i, p[1], count);
+            p += 2;
+        }
+        i += count;
+    }
+    return true;
+}
+
+// Reads and indexes a capture; returns the number of keyframes the deltas did not reproduce, -1 if unreadable
+int LoadCapture(const string& path) {
+    ifstream file(path, ios::binary);
+    if (!file.is_open()) return -1;
+    vector<unsigned char> packed((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+    CaptureHeader header;
+    watchFileBytes = packed.size();
+    if (packed.size() < sizeof(header)) return -1;
+    memcpy(&header, packed.data(), sizeof(header));
+    if (memcmp(header.magic, "NWCP", 4) != 0 || header.version != CAPTURE_VERSION ||
+        header.width == 0 || header.height == 0 || header.width > 4096 || header.height > 4096) return -1;
+
+    // Unpack every block; a torn last block (the game was killed) is left out
+    unique_ptr<ByteModel> model(new ByteModel());
+    model->Reset();
+    watchData.clear();
+    size_t at = sizeof(header);
+    uint32_t sizes[2];
+    while (packed.size() - at >= sizeof(sizes)) {
+        memcpy(sizes, &packed[at], sizeof(sizes));
+        at += sizeof(sizes);
+        if (sizes[1] > packed.size() - at) break;
+        RangeDecoder decoder(&packed[at], &packed[at] + sizes[1]);
+        for (uint32_t i = 0; i < sizes[0]; i++) watchData.push_back(decoder.Byte(*model));
+        at += sizes[1];
+    }
+
+    watchFrame.board.Resize(header.width, header.height, 0);
+    watchFrame.colors.Resize(header.width, header.height, WHITE);
+    const unsigned char* p = watchData.data();
+    const unsigned char* end = p + watchData.size();
+    long long timeUs = 0, tick = 0;
+    int mismatches = 0, key = -1;
+    watchFrames.clear();
+    while (p < end) {
+        CaptureFrameInfo info = { (size_t)(p - watchData.data()), 0, 0, key, *p != 'T', false };
+        bool isKey = *p == 'K';
+        unsigned long long before = HashBytes(HashBytes(FNV_OFFSET, watchFrame.board.cells.data(), watchFrame.board.cells.size()),
+                                              watchFrame.colors.cells.data(), watchFrame.colors.cells.size());
+        unsigned long long shown = 0;
+        if (!DecodeCaptureFrame(p, end, watchFrame, timeUs, tick, shown)) {
+            cerr << "Capture corrupt after " << watchFrames.size() << " frames" << endl;
+            break;
+        }
+        if (isKey) {
+            info.key = key = (int)watchFrames.size();
+            if (shown != 0 && shown != before) mismatches++;
+        }
+        if (key < 0) return -1; // Must start with a keyframe
+        info.timeUs = timeUs;
+        info.tick = tick;
+        info.paused = watchFrame.paused;
+        watchFrames.push_back(info);
+    }
+    watchShown = (int)watchFrames.size() - 1;
+    return mismatches;
+}
+
+// Decodes frame k into watchFrame, from the nearest keyframe unless it can
+// carry on from the frame already shown
+void SeekCapture(int k) {
+    if (k == watchShown) return;
+    int from = watchFrames[k].key;
+    if (watchShown >= from && watchShown < k) from = watchShown + 1;
+    long long timeUs = 0, tick = 0;
+    unsigned long long shown;
+    if (from > 0) { timeUs = watchFrames[from - 1].timeUs; tick = watchFrames[from - 1].tick; }
+    for (int i = from; i <= k; i++) {
+        const unsigned char* p = watchData.data() + watchFrames[i].offset;
+        DecodeCaptureFrame(p, watchData.data() + watchData.size(), watchFrame, timeUs, tick, shown);
+    }
+    watchShown = k;
+}
+
+int PrintCaptureSummary(const string& path, int mismatches) {
+    const size_t n = watchFrames.size();
+    vector<pair<long long, int>> gaps; // (gap, frame), not counting time spent paused
+    int keyframes = 0, boards = 0;
+    long long playedUs = 0; // First to last frame, less the paused spans; the menu before the first frame is left out
+    for (size_t i = 0; i < n; i++) {
+        keyframes += watchFrames[i].key == (int)i;
+        boards += watchFrames[i].board;
+        if (i > 0 && !watchFrames[i - 1].paused) {
+            gaps.push_back({ watchFrames[i].timeUs - watchFrames[i - 1].timeUs, (int)i });
+            playedUs += gaps.back().first;
+        }
+    }
+    double seconds = playedUs / 1e6;
+    cout << "NISHIT-WARRIORS capture " << path << endl;
+    cout << "  frames:     " << n << " (" << boards << " boards, " << keyframes << " keyframes) over " << fixed << setprecision(1)
+         << seconds << " s of play, ticks " << (n ? watchFrames[0].tick : 0) << " to " << (n ? watchFrames[n - 1].tick : 0) << endl;
+    cout << "  size:       " << watchFileBytes << " bytes (" << watchData.size() << " unpacked), " << setprecision(1)
+         << (n ? (double)watchFileBytes / n : 0.0) << " bytes/frame, "
+         << (seconds > 0 ? watchFileBytes / seconds * 3600 / (1024 * 1024) : 0.0) << " MB/hour" << endl;
+    if (!gaps.empty()) {
+        sort(gaps.begin(), gaps.end(), greater<pair<long long, int>>());
+        long long stutters = count_if(gaps.begin(), gaps.end(), [](const pair<long long, int>& g) { return g.first > STUTTER_US; });
+        cout << "  intervals:  mean " << setprecision(2) << playedUs / 1000.0 / gaps.size() << " ms, max "
+             << gaps[0].first / 1000.0 << " ms" << endl;
+        cout << "  stutters:   " << stutters << " frames over " << STUTTER_US / 1000.0 << " ms late";
+        for (size_t i = 0; i < gaps.size() && i < 5 && gaps[i].first > STUTTER_US; i++)
+            cout << (i ? ", " : "; longest at ") << setprecision(1) << watchFrames[gaps[i].second].timeUs / 1e6
+                 << " s (" << gaps[i].first / 1000.0 << " ms)";
+        cout << endl;
+    }
+    cout << "  keyframes:  " << (mismatches == 0 ? "deltas match" : to_string(mismatches) + " not matched by the deltas") << endl;
+    return mismatches == 0 ? 0 : 1;
+}
+
+// Plays a capture back at any speed. Keys: space pause, + and - speed,
+// [ and ] seek 5 s, , and . step a frame, 0 restart, q or ESC quit.
+// With fast set it only checks the file and prints a summary.
+int RunWatch(const string& path, double speed, bool fast) {
+    int mismatches = LoadCapture(path);
+    if (mismatches < 0 || watchFrames.empty()) {
+        cerr << "Cannot read capture: " << path << endl;
+        return 1;
+    }
+    if (fast) return PrintCaptureSummary(path, mismatches);
+
+    console = &systemConsole;
+    if (!console->Open()) {
+        cerr << "Watching a capture needs a terminal; use --fast for a summary." << endl;
+        return 1;
+    }
+    Arena arena;
+    arena.width = watchFrame.board.width; arena.height = watchFrame.board.height;
+    game.Configure(arena);
+    InitRenderer();
+    console->Clear();
+
+    const long long endUs = watchFrames.back().timeUs;
+    double playUs = 0.0;
+    bool paused = false;
+    int shown = -1;
+    auto wall = steady_clock::now();
+    while (true) {
+        // Last frame at or before the play position
+        auto next = upper_bound(watchFrames.begin(), watchFrames.end(), (long long)playUs,
+                                [](long long t, const CaptureFrameInfo& f) { return t < f.timeUs; });
+        int k = max(0, (int)(next - watchFrames.begin()) - 1);
+        if (k != shown) {
+            SeekCapture(k);
+            snprintf(watchFrame.profileText, sizeof(watchFrame.profileText),
+                     " WATCH %.1f/%.1f s | x%g%s | frame %d/%d tick %lld | space + - [ ] , . 0 q",
+                     watchFrames[k].timeUs / 1e6, endUs / 1e6, speed, paused ? " PAUSED" : "",
+                     k + 1, (int)watchFrames.size(), watchFrames[k].tick);
+            RenderFrame(watchFrame);
+            shown = k;
+        }
+
+        // Sleep until the next frame is due or a key arrives
+        int waitMs = 100;
+        if (!paused && next != watchFrames.end())
+            waitMs = (int)min(100.0, max(0.0, (next->timeUs - playUs) / speed / 1000));
+        if (paused || playUs >= endUs) waitMs = -1;
+        bool pressed = console->WaitForKey(waitMs);
+        auto now = steady_clock::now();
+        if (!paused) playUs = min((double)endUs, playUs + duration<double, micro>(now - wall).count() * speed);
+        wall = now;
+        if (!pressed) continue;
+
+        int ch = console->ReadKey();
+        if (ch == 'q' || ch == 'Q' || ch == 27) break;
+        if (ch == ' ') paused = !paused;
+        else if (ch == '+' || ch == '=') speed = min(64.0, speed * 2);
+        else if (ch == '-') speed = max(1.0 / 64, speed / 2);
+        else if (ch == '[') playUs = max(0.0, playUs - 5e6);
+        else if (ch == ']') playUs = min((double)endUs, playUs + 5e6);
+        else if (ch == '0') playUs = 0.0;
+        else if (ch == ',' || ch == '.') {
+            paused = true;
+            int step = max(0, min((int)watchFrames.size() - 1, k + (ch == '.' ? 1 : -1)));
+            playUs = (double)watchFrames[step].timeUs;
+        }
+        shown = -1; // Refresh the status line
+    }
+    console->Clear();
+    console->Flush();
+    CloseConsole();
+    console = &nullConsole;
+    return 0;
+}
+
+// Reference for the swept test: the discrete rule checked at many points
+// along the tick, with both bodies interpolated
+bool SubsteppedHit(float bx, float by, float dx, float dy, const Object& e) {
+    const int SUBSTEPS = 64;
+    for (int k = 0; k <= SUBSTEPS; k++) {
+        float t = (float)k / SUBSTEPS;
+        float ex = e.prevX + (e.x - e.prevX) * t, ey = e.prevY + (e.y - e.prevY) * t;
+        float px = bx - dx * (1.0f - t), py = by - dy * (1.0f - t);
+        if (px >= ex && px <= ex + ENEMY_HIT_WIDTH && fabs(py - ey) < 2.0f - SWEEP_EPSILON) return true;
+    }
+    return false;
+}
+
+// Fills the pools with random entities and times the brute-force hit scan
+// against the grid broadphase (including its per-tick rebuild)
+int RunCollisionBenchmark(unsigned int seed) {
+    const int ROUNDS = 20000;
+    const float SPREADS[] = { 0.0f, -PLAYER_BULLET_SPREAD, PLAYER_BULLET_SPREAD };
+    Rng rng;
+    rng.Seed(seed, 0);
+    game.enemies.clear(); game.playerBullets.clear();
+    while (!game.enemies.full()) {
+        Object e = { 2 + rng.Range(WIDTH - 2), 2 + rng.Range(HEIGHT - 4), 1, 0 };
+        e.prevX = e.x + rng.Range(7);            // Moved left up to 6 columns this tick
+        e.prevY = e.y + (rng.Range(4) == 0 ? rng.Range(3) - 1 : 0); // Bosses track a row
+        game.enemies.push(e);
+    }
+    while (!game.playerBullets.full())
+        game.playerBullets.push(1 + rng.Range(WIDTH * 4) / 4.0f, 2 + rng.Range((HEIGHT - 4) * 4) / 4.0f,
+                                PLAYER_BULLET_SPEED, SPREADS[rng.Range(3)]);
+    const BulletStream& b = game.playerBullets;
+    const float dx = PLAYER_BULLET_SPEED;
+
+    game.BuildEnemyGrid();
+    int mismatches = 0, hits = 0, tunneled = 0, missed = 0;
+    for (int i = 0; i < b.size(); i++) {
+        int expected = game.FindHitEnemyBruteForce(b.x[i], b.y[i], dx, b.dy[i]);
+        if (game.FindHitEnemy(b.x[i], b.y[i], dx, b.dy[i]) != expected) mismatches++;
+        if (expected >= 0) hits++;
+        bool endHit = false, stepHit = false;
+        for (const Object& e : game.enemies) {
+            endHit = endHit || BulletHitsEnemy(b.x[i], b.y[i], e);
+            stepHit = stepHit || SubsteppedHit(b.x[i], b.y[i], dx, b.dy[i], e);
+        }
+        if (expected >= 0 && !endHit) tunneled++;
+        if (stepHit && expected < 0) missed++;
+    }
+
+    long long checksum = 0;
+    auto start = steady_clock::now();
+    for (int r = 0; r < ROUNDS; r++)
+        for (int i = 0; i < b.size(); i++) checksum += game.FindHitEnemyBruteForce(b.x[i], b.y[i], dx, b.dy[i]);
+    double bruteSeconds = duration<double>(steady_clock::now() - start).count();
+
+    start = steady_clock::now();
+    for (int r = 0; r < ROUNDS; r++) {
+        game.BuildEnemyGrid();
+        for (int i = 0; i < b.size(); i++) checksum -= game.FindHitEnemy(b.x[i], b.y[i], dx, b.dy[i]);
+    }
+    double gridSeconds = duration<double>(steady_clock::now() - start).count();
+
+    double queries = (double)ROUNDS * b.size();
+    cout << "NISHIT-WARRIORS collision benchmark" << endl;
+    cout << "  entities:    " << game.enemies.size() << " enemies, " << b.size() << " bullets, " << hits << " hits" << endl;
+    cout << "  swept:       " << tunneled << " hits missed by the end-of-tick test, "
+         << missed << " sub-stepped hits missed by the sweep" << endl;
+    cout << "  brute force: " << fixed << setprecision(1) << bruteSeconds * 1e9 / queries << " ns/bullet" << endl;
+    cout << "  grid:        " << gridSeconds * 1e9 / queries << " ns/bullet (incl. rebuild)" << endl;
+    cout << "  speedup:     " << setprecision(2) << bruteSeconds / gridSeconds << "x" << endl;
+    cout << "  mismatches:  " << mismatches << (checksum == 0 ? "" : " (checksum differs)") << endl;
+    return mismatches == 0 && missed == 0 && checksum == 0 ? 0 : 1;
+}
+
+// Tunnelling check for a lower tick rate: one fixed wave of enemies and
+// player bullets, played at half the real step for STEP_CHECK_TICKS and at
+// the real step for half as many ticks. Positions line up every two fine
+// ticks, so with swept hits both runs must kill the same enemies; enemies
+// enter right at the arena edge, where bullets leave it.
+const int STEP_CHECK_TICKS = 4800;
+const int STEP_CHECK_SPAWN = 8; // Fine ticks between spawns
+const unsigned int STEP_CHECK_SEED = 1;
+
+struct StepRun {
+    int kills, shots;
+};
+
+StepRun PlayStepScenario(int scale) {
+    const float SPREADS[] = { 0.0f, -PLAYER_BULLET_SPREAD, PLAYER_BULLET_SPREAD };
+    const int enemyStep = MAX_ENEMY_STEP / 2; // Per fine tick
+    unique_ptr<GameState> s(new GameState());
+    Rng rng;
+    rng.Seed(STEP_CHECK_SEED, 0);
+    StepRun run = {};
+    for (int t = 0; t < STEP_CHECK_TICKS / scale; t++) {
+        if (t * scale % STEP_CHECK_SPAWN == 0) {
+            int x = s->arena.width - 1 - rng.Range(ENEMY_HIT_WIDTH);
+            s->SpawnEnemy(x, 3 + rng.Range(s->arena.height - 6), 1, 0);
+            // Shots start anywhere, some a step short of the edge
+            float bx = 1 + rng.Range(s->arena.width - 2), by = 2 + rng.Range((s->arena.height - 4) * 4) / 4.0f;
+            s->playerBullets.push(bx, by, PLAYER_BULLET_SPEED / 2 * scale, SPREADS[rng.Range(3)] / 2 * scale);
+            run.shots++;
+        }
+        for (int i = 0; i < s->enemies.size(); i++) {
+            Object& e = s->enemies[i];
+            e.prevX = e.x; e.prevY = e.y;
+            e.x -= enemyStep * scale;
+        }
+        MoveBullets(s->playerBullets, s->arena);
+        s->BuildEnemyGrid();
+        for (int i = 0; i < s->playerBullets.size(); i++) {
+            const BulletStream& b = s->playerBullets;
+            int j = s->FindHitEnemy(b.x[i], b.y[i], b.dx[i], b.dy[i]);
+            if (j < 0) continue;
+            s->enemies[j].hp = 0;
+            run.kills++;
+            s->playerBullets.remove(i);
+            i--;
+        }
+        for (int i = 0; i < s->enemies.size(); i++)
+            if (s->enemies[i].x < -ENEMY_HIT_WIDTH) s->enemies[i].hp = 0; // Behind every bullet
+        s->RemoveDeadEnemies();
+    }
+    return run;
+}
+
+int RunStepCheck() {
+    StepRun fine = PlayStepScenario(1), coarse = PlayStepScenario(2);
+    bool match = fine.kills == coarse.kills && fine.shots == coarse.shots;
+    cout << "NISHIT-WARRIORS step size check" << endl;
+    cout << "  half step:   " << STEP_CHECK_TICKS << " ticks, " << fine.shots << " shots, " << fine.kills << " kills" << endl;
+    cout << "  full step:   " << STEP_CHECK_TICKS / 2 << " ticks, " << coarse.shots << " shots, " << coarse.kills << " kills" << endl;
+    cout << "  result:      " << (match ? "MATCH" : "MISMATCH") << endl;
+    return match ? 0 : 1;
+}
+
+// Spawn and update cost of boss fire at high bullet densities. Emitters along
+// the right edge fire every pattern in the table; "bulk" is FireVolley, "per
+// shot" rebuilds the same velocities one push at a time as the old boss code did.
+int RunPatternBenchmark(unsigned int seed) {
+    const int CAPS[] = { 256, 1024, 4096, 16384, 65536 };
+    const int SPAWN_ROUNDS = 200, MOVE_TICKS = 2000;
+    Rng rng;
+    rng.Seed(seed, 0);
+    unique_ptr<GameState> s(new GameState());
+    vector<float> emitterY(4096);
+    auto hashVelocities = [](const BulletStream& b) {
+        unsigned long long h = HashBytes(FNV_OFFSET, b.dx.data(), b.count * sizeof(float));
+        return HashBytes(h, b.dy.data(), b.count * sizeof(float));
+    };
+    cout << "NISHIT-WARRIORS pattern benchmark (" << bulletPatterns.size() << " patterns)" << endl;
+    cout << "      cap   bulk ns/shot   per-shot ns/shot   move ns/bullet" << endl;
+    bool same = true;
+    for (int cap : CAPS) {
+        Arena arena;
+        arena.width = 1000; arena.height = 250; arena.maxBullets = cap;
+        s->Configure(arena);
+        s->Setup();
+        s->playerX = 10; s->playerY = arena.height / 2;
+        for (float& y : emitterY) y = (float)(2 + rng.Range(arena.height - 4));
+        const float ex = (float)arena.width - 2;
+        BulletStream& b = s->enemyBullets;
+
+        long long shots = 0;
+        auto start = steady_clock::now();
+        for (int r = 0; r < SPAWN_ROUNDS; r++) {
+            b.clear();
+            for (int step = 0; b.count < cap; step++)
+                for (const BulletPattern& p : bulletPatterns) s->FireVolley(p, step, ex, emitterY[step % emitterY.size()]);
+            shots += b.count;
+        }
+        double bulkSeconds = duration<double>(steady_clock::now() - start).count();
+        unsigned long long bulkHash = hashVelocities(b);
+
+        start = steady_clock::now();
+        for (int r = 0; r < SPAWN_ROUNDS; r++) {
+            b.clear();
+            for (int step = 0; b.count < cap; step++) {
+                float y = emitterY[step % emitterY.size()];
+                for (const BulletPattern& p : bulletPatterns) {
+                    int first = p.first + (step % p.steps) * p.shots;
+                    for (int k = 0; k < p.shots; k++) {
+                        float vx = patternDx[first + k], vy = patternDy[first + k];
+                        float c = s->difficultyMultiplier, sn = 0.0f;
+                        if (p.aimed) {
+                            float ax = (float)s->playerX - ex, ay = (float)s->playerY - y;
+                            float len = sqrt(ax * ax + ay * ay);
+                            c = -ax / len * s->difficultyMultiplier; sn = -ay / len * s->difficultyMultiplier;
+                        }
+                        b.push(ex, y, vx * c - vy * sn, vx * sn + vy * c);
+                    }
+                }
+            }
+        }
+        double pushSeconds = duration<double>(steady_clock::now() - start).count();
+        same = same && bulkHash == hashVelocities(b);
+
+        // Keep the arena topped up while timing only the movement pass
+        double moveSeconds = 0.0;
+        long long moved = 0;
+        for (int tick = 0; tick < MOVE_TICKS; tick++) {
+            for (int step = tick; b.count < cap; step++)
+                for (const BulletPattern& p : bulletPatterns) s->FireVolley(p, step, ex, emitterY[step % emitterY.size()]);
+            moved += b.count;
+            start = steady_clock::now();
+            MoveBullets(b, arena);
+            moveSeconds += duration<double>(steady_clock::now() - start).count();
+        }
+        cout << "  " << setw(7) << cap << fixed << setprecision(2)
+             << setw(15) << bulkSeconds * 1e9 / shots
+             << setw(19) << pushSeconds * 1e9 / shots
+             << setw(17) << moveSeconds * 1e9 / moved << endl;
+    }
+    if (!same) cout << "  bulk and per-shot spawns differ" << endl;
+    return same ? 0 : 1;
+}
+
+// ==========================================
+// 19. MAIN GAME LOOP
+// ==========================================
+
+int main(int argc, char* argv[]) {
+    heapCounter = &gameHeap; // This is the game thread
+    unsigned int seed = (unsigned int)time(0);
+    bool headless = false, stress = false;
+    int batchGames = 0, batchThreads = 0;
+    Arena stressArena;
+    stressArena.width = 400; stressArena.height = 100;
+    int stressEnemyCap = 0, stressSpawn = 0;
+    string bench;
+    long long ticks = 0; // 0: the mode's default
+    string scriptPath, audioMode, profileCsvPath, recordPath, replayPath, patternsPath, capturePath, watchPath;
+    double watchSpeed = 1.0;
+    int captureFps = CAPTURE_DEFAULT_FPS;
+    bool replayFast = false;
+    bool checkHeap = false;
+    bool checkSnapshot = false;
+    bool checkStep = false;
+    bool profileOverlay = false;
+    bool showLeaderboard = false;
+    bool netplayTest = false, netHost = false;
+    int hostPort = 0, latencyMs = 0, lossPercent = 0;
+    string joinAddress;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--headless") headless = true;
+        else if (arg == "--batch" && i + 1 < argc) batchGames = atoi(argv[++i]);
+        else if (arg == "--threads" && i + 1 < argc) batchThreads = atoi(argv[++i]);
+        else if (arg == "--stress") stress = true;
+        else if (arg == "--width" && i + 1 < argc) stressArena.width = atoi(argv[++i]);
+        else if (arg == "--height" && i + 1 < argc) stressArena.height = atoi(argv[++i]);
+        else if (arg == "--enemy-cap" && i + 1 < argc) stressEnemyCap = atoi(argv[++i]);
+        else if (arg == "--bullet-cap" && i + 1 < argc) stressArena.maxBullets = atoi(argv[++i]);
+        else if (arg == "--spawn" && i + 1 < argc) stressSpawn = atoi(argv[++i]);
+        else if (arg == "--seed" && i + 1 < argc) seed = (unsigned int)strtoul(argv[++i], NULL, 10);
+        else if (arg == "--ticks" && i + 1 < argc) ticks = atoll(argv[++i]);
+        else if (arg == "--script" && i + 1 < argc) scriptPath = argv[++i];
+        else if (arg == "--audio" && i + 1 < argc) audioMode = argv[++i];
+        else if (arg == "--bench" && i + 1 < argc) bench = argv[++i];
+        else if (arg == "--patterns" && i + 1 < argc) patternsPath = argv[++i];
+        else if (arg == "--pacing-stats") showPacingStats = true;
+        else if (arg == "--profile") profileOverlay = true;
+        else if (arg == "--record" && i + 1 < argc) recordPath = argv[++i];
+        else if (arg == "--replay" && i + 1 < argc) replayPath = argv[++i];
+        else if (arg == "--fast") replayFast = true;
+        else if (arg == "--check-heap") checkHeap = true;
+        else if (arg == "--check-snapshot") checkSnapshot = true;
+        else if (arg == "--check-step") checkStep = true;
+        else if (arg == "--capture" && i + 1 < argc) capturePath = argv[++i];
+        else if (arg == "--capture-fps" && i + 1 < argc) captureFps = atoi(argv[++i]);
+        else if (arg == "--watch" && i + 1 < argc) watchPath = argv[++i];
+        else if (arg == "--speed" && i + 1 < argc) watchSpeed = atof(argv[++i]);
+        else if (arg == "--profile-csv" && i + 1 < argc) profileCsvPath = argv[++i];
+        else if (arg == "--leaderboard") showLeaderboard = true;
+        else if (arg == "--host" && i + 1 < argc) { netHost = true; hostPort = atoi(argv[++i]); }
+        else if (arg == "--join" && i + 1 < argc) joinAddress = argv[++i];
+        else if (arg == "--latency" && i + 1 < argc) latencyMs = max(0, atoi(argv[++i]));
+        else if (arg == "--loss" && i + 1 < argc) lossPercent = min(100, max(0, atoi(argv[++i])));
+        else if (arg == "--netplay-test") netplayTest = true;
+        else {
+            cerr << "Usage: " << argv[0] << " [--seed N] [--audio beep|null|off|FILE.wav] [--pacing-stats]"
+                 << " [--profile] [--profile-csv FILE] [--record FILE] [--replay FILE [--fast]]"
+                 << " [--capture FILE [--capture-fps N]] [--watch FILE [--speed X] [--fast]]"
+                 << " [--headless [--ticks N] [--script FILE] [--check-heap] [--check-snapshot]] [--batch N [--threads T] [--ticks N]]"
+                 << " [--stress [--width W] [--height H] [--enemy-cap N] [--bullet-cap N] [--spawn N] [--ticks N]]"
+                 << " [--patterns FILE] [--bench collision|patterns] [--check-step] [--leaderboard]"
+                 << " [--host PORT | --join HOST:PORT] [--netplay-test [--ticks N] [--script FILE]] [--latency MS] [--loss PCT]" << endl;
+            return 1;
+        }
+    }
+
+    string patternError;
+    if (!LoadBulletPatterns(patternsPath, patternError)) {
+        cerr << "Bad bullet patterns: " << patternError << endl;
+        return 1;
+    }
+
+    if (showLeaderboard) {
+        LoadLeaderboard();
+        PrintLeaderboard(cout, "", -1);
+        return 0;
+    }
+    if (bench == "collision") return RunCollisionBenchmark(seed);
+    if (bench == "patterns") return RunPatternBenchmark(seed);
+    if (checkStep) return RunStepCheck();
+    if (!watchPath.empty()) return RunWatch(watchPath, watchSpeed > 0 ? watchSpeed : 1.0, replayFast);
+    if (!bench.empty()) {
+        cerr << "Unknown benchmark: " << bench << endl;
+        return 1;
+    }
+    if (batchGames > 0) return RunBatch(batchGames, batchThreads, seed, ticks > 0 ? ticks : 200000); // Always silent: sounds are posted from one thread
+    if (stress) return RunStress(stressArena, stressEnemyCap, stressSpawn, seed, ticks > 0 ? ticks : STRESS_TICKS);
+    if (netplayTest) {
+        soundsMuted = true; // Both sides run in this process
+        return RunNetplayTest(seed, ticks > 0 ? (int)ticks : NETPLAY_TEST_TICKS, scriptPath, latencyMs, lossPercent);
+    }
+    netplay = netHost || !joinAddress.empty();
+    if (netplay && (headless || !replayPath.empty() || !recordPath.empty() || (netHost && !joinAddress.empty()))) {
+        cerr << "--host and --join start a live two-player game on their own" << endl;
+        return 1;
+    }
+
+    // Headless runs and fast replays are silent unless a sink is asked for
+    AudioSink sink = (headless || (replayFast && !replayPath.empty())) ? AUDIO_OFF : AUDIO_BEEP;
+    if (audioMode == "off") sink = AUDIO_OFF;
+    else if (audioMode == "null") sink = AUDIO_NULL;
+    else if (audioMode == "beep") sink = AUDIO_BEEP;
+    else if (!audioMode.empty()) sink = AUDIO_WAV;
+    if (!StartAudio(sink, audioMode)) {
+        cerr << "Cannot open audio output: " << audioMode << endl;
+        return 1;
+    }
+
+    // Captures hold drawn frames, so only live games and real-time replays have any
+    if (!capturePath.empty() && (headless || replayFast)) {
+        cerr << "--capture needs a live game or a real-time replay" << endl;
+        return 1;
+    }
+    if (!replayPath.empty()) {
+        if (!capturePath.empty() && !StartCapture(capturePath, captureFps)) {
+            cerr << "Cannot write capture: " << capturePath << endl;
+            return 1;
+        }
+        int result = RunReplay(replayPath, replayFast);
+        StopCapture();
+        return result;
+    }
+    if (headless) return RunHeadless(seed, ticks > 0 ? ticks : 200000, scriptPath, recordPath, checkHeap, checkSnapshot);
+
+    // Before the console takes over the screen, so warnings stay visible
+    LoadLeaderboard();
+    highScore = leaderboardCount > 0 ? leaderboard[0].score : 0;
+    string snapshotError;
+    if (!LoadSnapshot(QUICKSAVE_FILE, quicksave, snapshotError) && ifstream(QUICKSAVE_FILE).good()) {
+        cerr << "Ignoring saved game " << QUICKSAVE_FILE << ": " << snapshotError << endl;
+    }
+    if (netplay) {
+        net.latencyMs = latencyMs;
+        net.lossPercent = lossPercent;
+        if (!NetOpen(net, hostPort, joinAddress, seed)) {
+            cerr << "Cannot open " << (netHost ? "UDP port " + to_string(hostPort) : joinAddress) << endl;
+            return 1;
+        }
+        cerr << (netHost ? "Waiting for a second player on port " + to_string(BoundPort(net.sock)) : "Joining " + joinAddress)
+             << "..." << endl;
+        if (!NetWaitConnected(net, netHost ? 0 : NET_TIMEOUT_MS)) {
+            cerr << "No answer from " << joinAddress << endl;
+            return 1;
+        }
+        seed = net.seed;
+    }
+
+    console = &systemConsole;
+    if (!console->Open()) {
+        cerr << "Interactive play needs a terminal; use --headless or --replay FILE --fast." << endl;
+        return 1;
+    }
+    atexit(CloseConsole);
+
+    SeedRandom(seed);
+    StartLeaderboardWriter();
+    atexit(StopLeaderboardWriter);
+
+    InitRenderer();
+    if (!StartProfiler(profileOverlay, profileCsvPath)) {
+        cerr << "Cannot open profile CSV: " << profileCsvPath << endl;
+        return 1;
+    }
+    if (!capturePath.empty() && !StartCapture(capturePath, captureFps)) {
+        cerr << "Cannot write capture: " << capturePath << endl;
+        return 1;
+    }
+    RunScreens(seed, recordPath);
+    StopCapture();
+    StopProfiler();
+    StopLeaderboardWriter();
+    return 0;
+}